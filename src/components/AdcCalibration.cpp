@@ -0,0 +1,196 @@
+#include "AdcCalibration.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <esp_adc_cal.h>
+
+#define ADC_CAL_DEFAULT_VREF 1100 // Used when the eFuse holds no Vref/two-point data
+#define ADC_CAL_NAMESPACE "adccal"
+
+static const adc_unit_t ADC_CAL_ESP_UNITS[ADC_CAL_UNITS] = {ADC_UNIT_1, ADC_UNIT_2};
+static const char *ADC_CAL_POINT_KEYS[ADC_CAL_UNITS] = {"points1", "points2"};
+
+AdcCalibration::AdcCalibration() {
+  // Until begin() runs, behave like an ideal 3.3V full-scale ADC
+  for (int unit = 0; unit < ADC_CAL_UNITS; unit++) {
+    pointCount[unit] = 0;
+    source[unit] = "Ideal";
+    for (int i = 0; i < ADC_CAL_KNOTS; i++) {
+      knots[unit][i] = (uint32_t)(i * ADC_CAL_KNOT_STEP) * 3300 / ADC_CAL_CODES;
+    }
+    rebuildTable(unit);
+  }
+}
+
+void AdcCalibration::begin() {
+  // analogRead() uses 11dB attenuation by default; the eFuse holds separate data per unit
+  for (int unit = 0; unit < ADC_CAL_UNITS; unit++) {
+    esp_adc_cal_characteristics_t characteristics;
+    esp_adc_cal_value_t type = esp_adc_cal_characterize(
+        ADC_CAL_ESP_UNITS[unit], ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, ADC_CAL_DEFAULT_VREF, &characteristics);
+
+    if (type == ESP_ADC_CAL_VAL_EFUSE_TP) {
+      source[unit] = "eFuse Two Point";
+    } else if (type == ESP_ADC_CAL_VAL_EFUSE_VREF) {
+      source[unit] = "eFuse Vref";
+    } else {
+      source[unit] = "Default Vref";
+    }
+
+    // The last knot sits one code past the end of the range; sample the top code instead
+    for (int i = 0; i < ADC_CAL_KNOTS; i++) {
+      int raw = min(i * ADC_CAL_KNOT_STEP, ADC_CAL_CODES - 1);
+      knots[unit][i] = esp_adc_cal_raw_to_voltage(raw, &characteristics);
+    }
+    pointCount[unit] = 0;
+  }
+
+  // Load the per-unit reference points captured at the factory. An uncalibrated
+  // unit has no namespace yet, which leaves the characterization alone.
+  Preferences prefs;
+  if (prefs.begin(ADC_CAL_NAMESPACE, true)) {
+    for (int unit = 0; unit < ADC_CAL_UNITS; unit++) {
+      size_t length = prefs.getBytes(ADC_CAL_POINT_KEYS[unit], points[unit], sizeof(points[unit]));
+      if (length % sizeof(AdcCalPoint) != 0) {
+        length = 0; // Partial point, the table was not written by savePoints()
+      }
+
+      pointCount[unit] = length / sizeof(AdcCalPoint);
+      for (int i = 0; i < pointCount[unit]; i++) {
+        bool sorted = (i == 0) || (points[unit][i].raw > points[unit][i - 1].raw);
+        if (points[unit][i].raw >= ADC_CAL_CODES || !sorted) {
+          pointCount[unit] = 0; // Corrupt table, fall back to the characterization alone
+          break;
+        }
+      }
+    }
+    prefs.end();
+  }
+
+  for (int unit = 0; unit < ADC_CAL_UNITS; unit++) {
+    rebuildTable(unit);
+  }
+}
+
+int AdcCalibration::characterizedMillivolts(int unit, int raw) const {
+  int knot = raw >> ADC_CAL_KNOT_SHIFT;
+  int fraction = raw & (ADC_CAL_KNOT_STEP - 1);
+  int lower = knots[unit][knot];
+  int upper = knots[unit][knot + 1];
+  return lower + ((upper - lower) * fraction) / ADC_CAL_KNOT_STEP;
+}
+
+void AdcCalibration::rebuildTable(int unit) {
+  const AdcCalPoint *unitPoints = points[unit];
+  int count = pointCount[unit];
+
+  // Correction offset (reference - characterized) at each reference point
+  int offsets[ADC_CAL_MAX_POINTS];
+  for (int i = 0; i < count; i++) {
+    offsets[i] = unitPoints[i].millivolts - characterizedMillivolts(unit, unitPoints[i].raw);
+  }
+
+  // Walk the codes in order so the correction segment only ever moves forward.
+  // Outside the captured range the nearest offset is held constant.
+  int segment = 0;
+  for (int raw = 0; raw < ADC_CAL_CODES; raw++) {
+    int millivolts = characterizedMillivolts(unit, raw);
+
+    if (count == 1 || (count > 1 && raw <= unitPoints[0].raw)) {
+      millivolts += offsets[0];
+    } else if (count > 1 && raw >= unitPoints[count - 1].raw) {
+      millivolts += offsets[count - 1];
+    } else if (count > 1) {
+      while (raw > unitPoints[segment + 1].raw) {
+        segment++;
+      }
+      int span = unitPoints[segment + 1].raw - unitPoints[segment].raw;
+      int offset = offsets[segment] +
+                   ((offsets[segment + 1] - offsets[segment]) * (raw - unitPoints[segment].raw)) / span;
+      millivolts += offset;
+    }
+
+    table[unit][raw] = constrain(millivolts, 0, 0xFFFF);
+  }
+}
+
+int AdcCalibration::addPoint(int pin, int raw, int millivolts) {
+  if (raw < 0 || raw >= ADC_CAL_CODES || millivolts < 0 || millivolts > ADC_CAL_MAX_MILLIVOLTS) {
+    return ADC_CAL_POINT_INVALID;
+  }
+
+  // A point only corrects the unit it was captured on
+  int unit = unitForPin(pin);
+
+  // Catches a reference taken before a divider (e.g. the battery voltage)
+  if (abs(millivolts - characterizedMillivolts(unit, raw)) > ADC_CAL_MAX_CORRECTION) {
+    return ADC_CAL_POINT_IMPLAUSIBLE;
+  }
+  AdcCalPoint *unitPoints = points[unit];
+  int &count = pointCount[unit];
+
+  // Find the insertion slot, replacing a point captured at the same code
+  int index = 0;
+  while (index < count && unitPoints[index].raw < raw) {
+    index++;
+  }
+
+  if (index < count && unitPoints[index].raw == raw) {
+    unitPoints[index].millivolts = millivolts;
+  } else {
+    if (count >= ADC_CAL_MAX_POINTS) {
+      return ADC_CAL_POINT_TABLE_FULL;
+    }
+    for (int i = count; i > index; i--) {
+      unitPoints[i] = unitPoints[i - 1];
+    }
+    unitPoints[index].raw = raw;
+    unitPoints[index].millivolts = millivolts;
+    count++;
+  }
+
+  rebuildTable(unit);
+  return ADC_CAL_POINT_ADDED;
+}
+
+void AdcCalibration::clearPoints() {
+  for (int unit = 0; unit < ADC_CAL_UNITS; unit++) {
+    pointCount[unit] = 0;
+    rebuildTable(unit);
+  }
+}
+
+bool AdcCalibration::savePoints() {
+  Preferences prefs;
+  if (!prefs.begin(ADC_CAL_NAMESPACE, false)) {
+    return false;
+  }
+
+  bool saved = true;
+  for (int unit = 0; unit < ADC_CAL_UNITS; unit++) {
+    const char *key = ADC_CAL_POINT_KEYS[unit];
+    if (pointCount[unit] > 0) {
+      size_t length = pointCount[unit] * sizeof(AdcCalPoint);
+      saved = (prefs.putBytes(key, points[unit], length) == length) && saved;
+    } else {
+      saved = (prefs.remove(key) || !prefs.isKey(key)) && saved;
+    }
+  }
+  prefs.end();
+  return saved;
+}
+
+int AdcCalibration::getPointCount(int unit) const {
+  return pointCount[unit];
+}
+
+const char *AdcCalibration::getSource(int unit) const {
+  return source[unit];
+}
+
+const uint16_t *AdcCalibration::getKnots(int unit) const {
+  return knots[unit];
+}
+
+const AdcCalPoint *AdcCalibration::getPoints(int unit) const {
+  return points[unit];
+}
@@ -0,0 +1,77 @@
+#ifndef ADC_CALIBRATION_H
+#define ADC_CALIBRATION_H
+
+#include <stdint.h>
+
+#define ADC_CAL_CODES 4096        // 12-bit ADC (analogReadResolution(12))
+#define ADC_CAL_KNOT_SHIFT 7      // One characterization knot every 128 codes
+#define ADC_CAL_KNOT_STEP (1 << ADC_CAL_KNOT_SHIFT)
+#define ADC_CAL_KNOTS ((ADC_CAL_CODES >> ADC_CAL_KNOT_SHIFT) + 1)
+#define ADC_CAL_MAX_POINTS 8      // Factory reference points per ADC unit
+#define ADC_CAL_MAX_MILLIVOLTS 3300   // Top of the 11dB input range
+#define ADC_CAL_MAX_CORRECTION 300    // Largest plausible reference - characterized difference (mV)
+
+// addPoint() results
+#define ADC_CAL_POINT_ADDED 0
+#define ADC_CAL_POINT_INVALID 1     // Code or millivolts outside the ADC range
+#define ADC_CAL_POINT_IMPLAUSIBLE 2 // Too far from the characterization to be the pin voltage
+#define ADC_CAL_POINT_TABLE_FULL 3
+
+// ESP32 ADC units, indexed from 0
+#define ADC_CAL_UNITS 2
+#define ADC_CAL_UNIT_ADC1 0       // GPIO32-39 (battery)
+#define ADC_CAL_UNIT_ADC2 1       // GPIO0, 2, 4, 12-15, 25-27 (thermistor)
+
+// A factory reference point: raw code measured while a known voltage was on the pin
+struct AdcCalPoint {
+  uint16_t raw;
+  uint16_t millivolts;
+};
+
+// Converts raw ADC codes to pin millivolts. Each ADC unit has its own eFuse
+// characterization, so each gets its own knots, reference points and table.
+// The characterization is sampled into knots, the reference points are
+// layered on top as a piecewise-linear correction, and the result is
+// expanded into a code -> millivolt table so the read path is a single
+// array lookup.
+class AdcCalibration {
+private:
+  uint16_t knots[ADC_CAL_UNITS][ADC_CAL_KNOTS];          // Characterized millivolts at every knot
+  AdcCalPoint points[ADC_CAL_UNITS][ADC_CAL_MAX_POINTS]; // Sorted by raw code
+  int pointCount[ADC_CAL_UNITS];
+  const char *source[ADC_CAL_UNITS];                     // Which characterization the knots came from
+  uint16_t table[ADC_CAL_UNITS][ADC_CAL_CODES];          // Precomputed raw code -> millivolts
+
+  // Interpolate the characterization knots (no per-unit correction)
+  int characterizedMillivolts(int unit, int raw) const;
+  void rebuildTable(int unit);
+
+public:
+  AdcCalibration();
+
+  // Characterize both units from eFuse, load the stored reference points and build the tables
+  void begin();
+
+  static int unitForPin(int pin) {
+    return (pin >= 32 && pin <= 39) ? ADC_CAL_UNIT_ADC1 : ADC_CAL_UNIT_ADC2;
+  }
+
+  uint16_t toMillivolts(int pin, int raw) const {
+    if (raw < 0) raw = 0;
+    if (raw >= ADC_CAL_CODES) raw = ADC_CAL_CODES - 1;
+    return table[unitForPin(pin)][raw];
+  }
+
+  // Reference point management (used by the factory calibration command)
+  int addPoint(int pin, int raw, int millivolts); // One of ADC_CAL_POINT_*
+  void clearPoints();
+  bool savePoints();
+  int getPointCount(int unit) const;
+  const char *getSource(int unit) const;
+
+  // Raw calibration state, so a trace can reproduce this unit's tables
+  const uint16_t *getKnots(int unit) const;
+  const AdcCalPoint *getPoints(int unit) const;
+};
+
+#endif // ADC_CALIBRATION_H
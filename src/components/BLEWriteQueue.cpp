@@ -0,0 +1,34 @@
+#include "BLEWriteQueue.h"
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+struct PendingWrite {
+  uint8_t length;
+  char data[BLE_WRITE_MAX_LENGTH];
+};
+
+BLEWriteQueue::BLEWriteQueue() {
+  queue = xQueueCreate(BLE_WRITE_QUEUE_DEPTH, sizeof(PendingWrite));
+}
+
+bool BLEWriteQueue::push(const std::string &value) {
+  if (queue == NULL || value.length() > BLE_WRITE_MAX_LENGTH) {
+    return false;
+  }
+
+  PendingWrite write;
+  write.length = value.length();
+  memcpy(write.data, value.data(), value.length());
+  return xQueueSend((QueueHandle_t)queue, &write, 0) == pdTRUE;
+}
+
+bool BLEWriteQueue::pop(std::string &value) {
+  PendingWrite write;
+  if (queue == NULL || xQueueReceive((QueueHandle_t)queue, &write, 0) != pdTRUE) {
+    return false;
+  }
+
+  value.assign(write.data, write.length);
+  return true;
+}
@@ -0,0 +1,26 @@
+#ifndef BLE_WRITE_QUEUE_H
+#define BLE_WRITE_QUEUE_H
+
+#include <string>
+
+#define BLE_WRITE_QUEUE_DEPTH 4     // Writes a characteristic can have pending between loop() passes
+#define BLE_WRITE_MAX_LENGTH 128    // Longer writes are rejected; every command fits well within this
+
+// Hands characteristic writes from the BLE host task to loop(). The BLE task
+// only copies the value in and never waits, so it stays free to deliver the
+// notify confirmations that loop() blocks on while publishing.
+class BLEWriteQueue {
+private:
+  void *queue; // FreeRTOS queue, kept opaque for host builds
+
+public:
+  BLEWriteQueue();
+
+  // BLE task side; false if the write is too long or the queue is full
+  bool push(const std::string &value);
+
+  // loop() side; false when nothing is pending
+  bool pop(std::string &value);
+};
+
+#endif // BLE_WRITE_QUEUE_H
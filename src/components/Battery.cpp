@@ -1,8 +1,10 @@
 #include "Battery.h"
 #include <Arduino.h>
 
-Battery::Battery(int adcPin, float dividerRatio, float vMax, float vMin) {
+Battery::Battery(int adcPin, const AdcCalibration *calibration, TraceRecorder *traceRecorder, float dividerRatio, float vMax, float vMin) {
   this->adcPin = adcPin;
+  this->calibration = calibration;
+  this->traceRecorder = traceRecorder;
   this->dividerRatio = dividerRatio;
   voltageMax = vMax;
   voltageMin = vMin;
@@ -16,15 +18,16 @@ Battery::Battery(int adcPin, float dividerRatio, float vMax, float vMin) {
 }
 
 int Battery::readRawValue() {
-  return analogRead(adcPin);
+  int raw = analogRead(adcPin);
+  traceRecorder->recordAdc(adcPin, raw);
+  return raw;
 }
 
 float Battery::readVoltage() {
   int raw = readRawValue();
   
-  // Convert raw ADC value to voltage and apply divider ratio
-  // float currentVoltage = (raw / 4095.0 * 1.0263) * 3.3 * dividerRatio + .53;
-  float currentVoltage = (raw / 4095.0) * 3.3 * dividerRatio + .55;
+  // Convert raw ADC value to calibrated pin voltage and apply divider ratio
+  float currentVoltage = (calibration->toMillivolts(adcPin, raw) / 1000.0) * dividerRatio;
   
   // Update buffer with new reading
   voltageBuffer[bufferIndex] = currentVoltage;
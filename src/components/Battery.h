@@ -1,11 +1,16 @@
 #ifndef BATTERY_H
 #define BATTERY_H
 
+#include "AdcCalibration.h"
+#include "TraceRecorder.h"
+
 #define VOLTAGE_BUFFER_SIZE 10
 
 class Battery {
 private:
   int adcPin;
+  const AdcCalibration *calibration;
+  TraceRecorder *traceRecorder;
   float dividerRatio;
   float voltageMax;
   float voltageMin;
@@ -19,7 +24,7 @@ private:
   float calculateAverageVoltage();
   
 public:
-  Battery(int adcPin, float dividerRatio, float vMax, float vMin);
+  Battery(int adcPin, const AdcCalibration *calibration, TraceRecorder *traceRecorder, float dividerRatio, float vMax, float vMin);
   int readRawValue();
   float readVoltage();
   int calculatePercentage();
@@ -0,0 +1,122 @@
+#include "CalibrationManager.h"
+
+#define CALIBRATION_CAPTURE_SAMPLES 64 // Averaged per captured point to beat ADC noise
+
+CalibrationManager::CalibrationManager(BLEService *service, BLEServer *server, AdcCalibration *calibration,
+                                       TraceRecorder *recorder, int batteryPin, int thermistorPin)
+  : pServer(server), adcCalibration(calibration), traceRecorder(recorder), factoryMode(false) {
+  capturePins[0] = batteryPin;
+  capturePins[1] = thermistorPin;
+
+  calibrationCharacteristic = service->createCharacteristic(
+      "b7c5e0a4-3f1d-4c8e-9a6b-2d4f8e1c7a53",
+      BLECharacteristic::PROPERTY_READ | BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_NOTIFY);
+
+  calibrationCharacteristic->setCallbacks(new CalibrationCallbacks(this));
+  setResult("IDLE");
+}
+
+void CalibrationManager::CalibrationCallbacks::onWrite(BLECharacteristic *pCharacteristic) {
+  // Runs on the BLE task; loop() applies the write, so captures never overlap a tick
+  manager->writeQueue.push(pCharacteristic->getValue());
+}
+
+bool CalibrationManager::takePendingWrite(std::string &value) {
+  return writeQueue.pop(value);
+}
+
+void CalibrationManager::handleWrite(const std::string &value) {
+  if (value.length() > 0) {
+    StaticJsonDocument<200> doc;
+    DeserializationError error = deserializeJson(doc, value);
+
+    if (!error) {
+      handleCommand(doc.as<JsonObject>());
+    }
+  }
+}
+
+void CalibrationManager::handleCommand(const JsonObject &command) {
+  const char *name = command["command"] | "";
+
+  if (!factoryMode) {
+    setResult("LOCKED");
+  } else if (strcmp(name, "capture") == 0) {
+    int pin = command["pin"] | -1;
+    int millivolts = command["millivolts"] | -1;
+    if (!isCapturePin(pin) || millivolts < 0 || millivolts > ADC_CAL_MAX_MILLIVOLTS) {
+      setResult("BAD_ARGS");
+      return;
+    }
+
+    int raw = captureRawValue(pin);
+    calibrationDoc["lastRaw"] = raw;
+    calibrationDoc["lastMillivolts"] = millivolts;
+
+    int added = adcCalibration->addPoint(pin, raw, millivolts);
+    if (added == ADC_CAL_POINT_ADDED) {
+      setResult("CAPTURED");
+    } else if (added == ADC_CAL_POINT_IMPLAUSIBLE) {
+      setResult("BAD_REFERENCE");
+    } else if (added == ADC_CAL_POINT_TABLE_FULL) {
+      setResult("TABLE_FULL");
+    } else {
+      setResult("BAD_ARGS");
+    }
+  } else if (strcmp(name, "save") == 0) {
+    setResult(adcCalibration->savePoints() ? "SAVED" : "SAVE_FAILED");
+  } else if (strcmp(name, "clear") == 0) {
+    adcCalibration->clearPoints();
+    setResult("CLEARED");
+  } else {
+    setResult("UNKNOWN_COMMAND");
+  }
+}
+
+void CalibrationManager::setFactoryMode(bool enabled) {
+  factoryMode = enabled;
+  setResult(enabled ? "FACTORY_MODE" : "IDLE");
+}
+
+bool CalibrationManager::isFactoryMode() const {
+  return factoryMode;
+}
+
+bool CalibrationManager::isCapturePin(int pin) const {
+  for (int i = 0; i < CALIBRATION_CAPTURE_PINS; i++) {
+    if (capturePins[i] == pin) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int CalibrationManager::captureRawValue(int pin) {
+  long sum = 0;
+  for (int i = 0; i < CALIBRATION_CAPTURE_SAMPLES; i++) {
+    int raw = analogRead(pin);
+    traceRecorder->recordAdc(pin, raw);
+    sum += raw;
+  }
+  return (sum + CALIBRATION_CAPTURE_SAMPLES / 2) / CALIBRATION_CAPTURE_SAMPLES;
+}
+
+void CalibrationManager::setResult(const char *result) {
+  calibrationDoc["adc1Source"] = adcCalibration->getSource(ADC_CAL_UNIT_ADC1);
+  calibrationDoc["adc1Points"] = adcCalibration->getPointCount(ADC_CAL_UNIT_ADC1);
+  calibrationDoc["adc2Source"] = adcCalibration->getSource(ADC_CAL_UNIT_ADC2);
+  calibrationDoc["adc2Points"] = adcCalibration->getPointCount(ADC_CAL_UNIT_ADC2);
+  calibrationDoc["factoryMode"] = factoryMode;
+  calibrationDoc["result"] = result;
+  notifyCharacteristic();
+}
+
+void CalibrationManager::notifyCharacteristic() {
+  char jsonBuffer[256];
+  serializeJson(calibrationDoc, jsonBuffer);
+  calibrationCharacteristic->setValue(jsonBuffer);
+
+  if (pServer->getConnectedCount() > 0) {
+    calibrationCharacteristic->notify();
+  }
+}
@@ -0,0 +1,60 @@
+#ifndef CALIBRATION_MANAGER_H
+#define CALIBRATION_MANAGER_H
+
+#include <Arduino.h>
+#include <BLEServer.h>
+#include <BLECharacteristic.h>
+#include <ArduinoJson.h>
+#include "AdcCalibration.h"
+#include "BLEWriteQueue.h"
+#include "TraceRecorder.h"
+
+#define CALIBRATION_CAPTURE_PINS 2 // Battery and thermistor
+
+// Factory calibration over BLE. Write commands as JSON:
+//   {"command":"capture","pin":32,"millivolts":2030} - sample the pin against a reference
+//   {"command":"save"}                               - persist the captured points
+//   {"command":"clear"}                              - drop all captured points
+// Reference voltages are measured at the ADC pin, not before any divider:
+// above 3300 mV answers BAD_ARGS, and a reference more than
+// ADC_CAL_MAX_CORRECTION from what the pin reads answers BAD_REFERENCE.
+// Commands answer LOCKED unless factory mode was switched on with
+// setFactoryMode(), which main.cpp calls for the "factory on" serial console
+// command. Only the sensor pins can be captured: analogRead() would switch
+// any other pin, such as the heater output, to analog mode.
+class CalibrationManager {
+public:
+  CalibrationManager(BLEService *service, BLEServer *server, AdcCalibration *calibration, TraceRecorder *recorder,
+                     int batteryPin, int thermistorPin);
+
+  bool takePendingWrite(std::string &value);
+  void handleWrite(const std::string &value);
+  void handleCommand(const JsonObject &command);
+  void setFactoryMode(bool enabled);
+  bool isFactoryMode() const;
+
+private:
+  BLECharacteristic *calibrationCharacteristic;
+  BLEServer *pServer;
+  AdcCalibration *adcCalibration;
+  TraceRecorder *traceRecorder;
+  BLEWriteQueue writeQueue; // Client writes waiting for loop()
+  int capturePins[CALIBRATION_CAPTURE_PINS];
+  bool factoryMode;
+  StaticJsonDocument<256> calibrationDoc;
+
+  bool isCapturePin(int pin) const;
+  int captureRawValue(int pin);
+  void setResult(const char *result);
+  void notifyCharacteristic(); // Encapsulates notification logic
+
+  class CalibrationCallbacks : public BLECharacteristicCallbacks {
+  private:
+    CalibrationManager *manager;
+  public:
+    CalibrationCallbacks(CalibrationManager *mgr) : manager(mgr) {}
+    void onWrite(BLECharacteristic *pCharacteristic) override;
+  };
+};
+
+#endif // CALIBRATION_MANAGER_H
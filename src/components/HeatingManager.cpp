@@ -17,8 +17,15 @@ HeatingManager::HeatingManager(BLEService* service, BLEServer* server)
 }
 
 void HeatingManager::HeatingCallbacks::onWrite(BLECharacteristic* pCharacteristic) {
-  std::string value = pCharacteristic->getValue();
-  
+  // Runs on the BLE task; loop() applies the write
+  manager->writeQueue.push(pCharacteristic->getValue());
+}
+
+bool HeatingManager::takePendingWrite(std::string &value) {
+  return writeQueue.pop(value);
+}
+
+void HeatingManager::handleWrite(const std::string &value) {
   if (value.length() > 0) {
     StaticJsonDocument<200> doc;
     DeserializationError error = deserializeJson(doc, value);
@@ -27,7 +34,7 @@ void HeatingManager::HeatingCallbacks::onWrite(BLECharacteristic* pCharacteristi
       int newTemp = doc["targetTemperature"].as<int>();
       // Ensure temperature is within safe range
       if (newTemp >= 0 && newTemp <= 30) {
-        manager->setTargetTemperature(newTemp);
+        setTargetTemperature(newTemp);
       }
     }
   }
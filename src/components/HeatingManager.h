@@ -4,6 +4,7 @@
 #include <BLEServer.h>
 #include <BLEService.h>
 #include <ArduinoJson.h>
+#include "BLEWriteQueue.h"
 
 class HeatingManager {
 private:
@@ -11,6 +12,7 @@ private:
     BLEServer* pServer;
     StaticJsonDocument<256> heatingDoc;
     double targetTemperature;  // Changed from int to double
+    BLEWriteQueue writeQueue;  // Client writes waiting for loop()
     void notifyCharacteristic();
 
     class HeatingCallbacks : public BLECharacteristicCallbacks {
@@ -23,6 +25,8 @@ private:
 
 public:
     HeatingManager(BLEService* service, BLEServer* server);
+    bool takePendingWrite(std::string& value);
+    void handleWrite(const std::string& value);
     void updateHeatingData(const JsonObject& newData);
     void setTemperature(double temperature);  // Changed from int to double
     void setHeatingStatus(const char* status);
@@ -2,8 +2,10 @@
 #include <Arduino.h>
 #include <math.h>
 
-Temperature::Temperature(int adcPin, float nominal, float beta, float series, float refTemp) {
+Temperature::Temperature(int adcPin, const AdcCalibration *calibration, TraceRecorder *traceRecorder, float nominal, float beta, float series, float refTemp) {
   this->adcPin = adcPin;
+  this->calibration = calibration;
+  this->traceRecorder = traceRecorder;
   rNominal = nominal;
   bCoefficient = beta;
   seriesResistor = series;
@@ -11,13 +13,15 @@ Temperature::Temperature(int adcPin, float nominal, float beta, float series, fl
 }
 
 int Temperature::readRawValue() {
-  return analogRead(adcPin);
+  int raw = analogRead(adcPin);
+  traceRecorder->recordAdc(adcPin, raw);
+  return raw;
 }
 
 float Temperature::readVoltage() {
   int raw = readRawValue();
   
-  float voltage = (raw / 1023.0) * 3.3;
+  float voltage = calibration->toMillivolts(adcPin, raw) / 1000.0;
   return voltage;
 }
 
@@ -39,5 +43,5 @@ float Temperature::readTemperature() {
   steinhart = 1.0 / steinhart;            // Invert
   steinhart -= 273.15;                    // Convert to Celsius
   
-  return steinhart + 21.1; // Adjust for offset
+  return steinhart;
 }
\ No newline at end of file
@@ -1,19 +1,24 @@
 #ifndef TEMPERATURE_H
 #define TEMPERATURE_H
 
+#include "AdcCalibration.h"
+#include "TraceRecorder.h"
+
 // Define a function pointer type for battery voltage callback
 typedef float (*BatteryVoltageCallback)();
 
 class Temperature {
 private:
   int adcPin;
+  const AdcCalibration *calibration;
+  TraceRecorder *traceRecorder;
   float rNominal;
   float bCoefficient;
   float seriesResistor;
   float referenceTemp;
   
 public:
-  Temperature(int adcPin, float nominal, float beta, float series, float refTemp);
+  Temperature(int adcPin, const AdcCalibration *calibration, TraceRecorder *traceRecorder, float nominal, float beta, float series, float refTemp);
   int readRawValue();
   float readVoltage();
   float readResistance();
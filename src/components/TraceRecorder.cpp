@@ -0,0 +1,239 @@
+#include "TraceRecorder.h"
+#include <Arduino.h>
+
+#define TRACE_CLOSING_BYTES 7 // A DROPPED marker (1 + varint) and the END marker
+
+TraceRecorder::TraceRecorder() {
+  bufferLength = 0;
+  fileBytes = 0;
+  recording = false;
+  lastMillis = 0;
+  droppedEvents = 0;
+  unmarkedDrops = 0;
+  adcSlots = 0;
+}
+
+bool TraceRecorder::begin(const AdcCalibration *calibration) {
+  if (!storage.begin()) {
+    return false;
+  }
+
+  recording = true;
+
+  uint8_t header[TRACE_MAGIC_LENGTH + 1];
+  memcpy(header, TRACE_MAGIC, TRACE_MAGIC_LENGTH);
+  header[TRACE_MAGIC_LENGTH] = TRACE_VERSION;
+  append(header, sizeof(header), NULL, 0);
+
+  recordSession(calibration);
+  return true;
+}
+
+bool TraceRecorder::append(const uint8_t *header, size_t headerLength, const uint8_t *payload, size_t payloadLength) {
+  if (!recording) {
+    return false;
+  }
+
+  // Mark lost events where they were lost, so a replay stops there instead of diverging
+  if (unmarkedDrops > 0) {
+    uint8_t marker[6];
+    marker[0] = traceEventByte(TRACE_EVENT_DROPPED, 0);
+    size_t markerLength = 1 + traceEncodeVarint(unmarkedDrops, marker + 1);
+    if (bufferLength + markerLength > TRACE_BUFFER_SIZE) {
+      recordDrop();
+      return false;
+    }
+    memcpy(buffer + bufferLength, marker, markerLength);
+    bufferLength += markerLength;
+    unmarkedDrops = 0;
+  }
+
+  // Events are all-or-nothing; a partial event would desynchronize the replay
+  size_t length = headerLength + payloadLength;
+  if (bufferLength + length > TRACE_BUFFER_SIZE) {
+    recordDrop();
+    return false;
+  }
+
+  memcpy(buffer + bufferLength, header, headerLength);
+  if (payloadLength > 0) {
+    memcpy(buffer + bufferLength + headerLength, payload, payloadLength);
+  }
+  bufferLength += length;
+  return true;
+}
+
+void TraceRecorder::recordDrop() {
+  droppedEvents++;
+  unmarkedDrops++;
+}
+
+size_t TraceRecorder::encodeTimestamp(unsigned long now, uint8_t *out) {
+  int32_t delta = (int32_t)(now - lastMillis);
+  lastMillis = now;
+  return traceEncodeVarint(traceZigzag(delta), out);
+}
+
+void TraceRecorder::recordSession(const AdcCalibration *calibration) {
+  uint8_t event[1 + 5 + ADC_CAL_UNITS * (1 + 32 + ADC_CAL_KNOTS * 3 + 1 + ADC_CAL_MAX_POINTS * 6)];
+  size_t length = 0;
+
+  event[length++] = traceEventByte(TRACE_EVENT_SESSION, 0);
+  lastMillis = millis();
+  length += traceEncodeVarint(lastMillis, event + length);
+
+  for (int unit = 0; unit < ADC_CAL_UNITS; unit++) {
+    const char *source = calibration->getSource(unit);
+    size_t sourceLength = min(strlen(source), (size_t)32);
+    event[length++] = sourceLength;
+    memcpy(event + length, source, sourceLength);
+    length += sourceLength;
+
+    const uint16_t *knots = calibration->getKnots(unit);
+    for (int i = 0; i < ADC_CAL_KNOTS; i++) {
+      length += traceEncodeVarint(knots[i], event + length);
+    }
+
+    const AdcCalPoint *points = calibration->getPoints(unit);
+    int pointCount = calibration->getPointCount(unit);
+    event[length++] = pointCount;
+    for (int i = 0; i < pointCount; i++) {
+      length += traceEncodeVarint(points[i].raw, event + length);
+      length += traceEncodeVarint(points[i].millivolts, event + length);
+    }
+  }
+
+  append(event, length, NULL, 0);
+}
+
+void TraceRecorder::recordAdc(int pin, int raw) {
+  if (!recording) {
+    return;
+  }
+
+  int slot = 0;
+  while (slot < adcSlots && adcPins[slot] != pin) {
+    slot++;
+  }
+
+  if (slot == adcSlots) {
+    if (slot >= TRACE_MAX_ADC_SLOTS) {
+      recordDrop();
+      return;
+    }
+    uint8_t declare[2] = {traceEventByte(TRACE_EVENT_ADC_PIN, slot), (uint8_t)pin};
+    if (!append(declare, sizeof(declare), NULL, 0)) {
+      return;
+    }
+    adcPins[slot] = pin;
+    adcPrevious[slot] = 0;
+    adcSlots++;
+  }
+
+  uint8_t event[6];
+  event[0] = traceEventByte(TRACE_EVENT_ADC, slot);
+  size_t length = 1 + traceEncodeVarint(traceZigzag(raw - adcPrevious[slot]), event + 1);
+  if (append(event, length, NULL, 0)) {
+    adcPrevious[slot] = raw;
+  }
+}
+
+void TraceRecorder::recordTick(unsigned long now, int connectedCount) {
+  uint8_t event[6];
+  event[0] = traceEventByte(TRACE_EVENT_TICK, connectedCount);
+  size_t length = 1 + encodeTimestamp(now, event + 1);
+  append(event, length, NULL, 0);
+}
+
+void TraceRecorder::recordConnection(unsigned long now, int connectedCount) {
+  uint8_t event[6];
+  event[0] = traceEventByte(TRACE_EVENT_CONNECTION, connectedCount);
+  size_t length = 1 + encodeTimestamp(now, event + 1);
+  append(event, length, NULL, 0);
+}
+
+void TraceRecorder::recordBleWrite(unsigned long now, int channel, const std::string &value) {
+  recordData(TRACE_EVENT_BLE_WRITE, channel, now, value);
+}
+
+void TraceRecorder::recordSerialCommand(unsigned long now, const std::string &command) {
+  recordData(TRACE_EVENT_SERIAL, 0, now, command);
+}
+
+void TraceRecorder::recordData(int type, int arg, unsigned long now, const std::string &data) {
+  uint8_t header[11];
+  header[0] = traceEventByte(type, arg);
+  size_t headerLength = 1 + encodeTimestamp(now, header + 1);
+  headerLength += traceEncodeVarint(data.length(), header + headerLength);
+  append(header, headerLength, (const uint8_t *)data.data(), data.length());
+}
+
+void TraceRecorder::flush() {
+  if (recording && bufferLength >= TRACE_FLUSH_BYTES) {
+    writeBuffer();
+  }
+}
+
+void TraceRecorder::writeBuffer() {
+  // Stop while this buffer and the closing markers still fit, so the tail is kept.
+  // A replay has to start from the session event, so the file never wraps.
+  if (fileBytes + bufferLength + TRACE_BUFFER_SIZE + TRACE_CLOSING_BYTES > TRACE_MAX_FILE_BYTES) {
+    stop(TRACE_END_SIZE_LIMIT);
+    return;
+  }
+
+  size_t written = storage.write(buffer, bufferLength);
+  fileBytes += written;
+  if (written != bufferLength) {
+    // Flash full or failing: the file ends mid-event, which the replayer reports as truncated
+    droppedEvents++;
+    storage.close();
+    recording = false;
+  }
+  bufferLength = 0;
+}
+
+void TraceRecorder::stop(int reason) {
+  uint8_t closing[TRACE_CLOSING_BYTES];
+  size_t length = 0;
+  if (unmarkedDrops > 0) {
+    closing[length++] = traceEventByte(TRACE_EVENT_DROPPED, 0);
+    length += traceEncodeVarint(unmarkedDrops, closing + length);
+    unmarkedDrops = 0;
+  }
+  closing[length++] = traceEventByte(TRACE_EVENT_END, reason);
+
+  fileBytes += storage.write(buffer, bufferLength);
+  fileBytes += storage.write(closing, length);
+  storage.close();
+  bufferLength = 0;
+  recording = false;
+}
+
+bool TraceRecorder::beginDump(bool previous) {
+  // Put everything recorded so far on flash first
+  if (!previous && recording && bufferLength > 0) {
+    writeBuffer();
+  }
+  return storage.beginDump(previous);
+}
+
+void TraceRecorder::continueDump() {
+  storage.continueDump();
+}
+
+bool TraceRecorder::isDumping() const {
+  return storage.isDumping();
+}
+
+bool TraceRecorder::isRecording() const {
+  return recording;
+}
+
+size_t TraceRecorder::getFileBytes() const {
+  return fileBytes;
+}
+
+unsigned long TraceRecorder::getDroppedEvents() const {
+  return droppedEvents;
+}
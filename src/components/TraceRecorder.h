@@ -0,0 +1,77 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include "AdcCalibration.h"
+#include "TraceStorage.h"
+#include "../utils/TraceFormat.h"
+
+#define TRACE_BUFFER_SIZE 2048 // RAM staging buffer between flash writes
+#define TRACE_FLUSH_BYTES 512  // Write to flash once this much is buffered
+
+// Retention: a trace covers the boot from power-on until the file reaches
+// TRACE_MAX_FILE_BYTES, about 12 h at the typical 50 KB/h. Recording then
+// writes out its buffered tail, appends an END marker and stops until the
+// next boot. The previous boot's trace is kept too, so two full files have
+// to fit the LittleFS partition (1.375 MB with the default partition table).
+#ifndef TRACE_MAX_FILE_BYTES
+#define TRACE_MAX_FILE_BYTES (640 * 1024)
+#endif
+
+// Records every input the control loop consumes (raw ADC codes, loop ticks,
+// BLE writes, connection changes and serial commands) into a binary log on
+// LittleFS, so a field trace can be replayed on the host by tools/replay.
+// Only loop() records: BLE writes and connection changes reach it through
+// loop() as well, so the log order is the order the firmware saw its inputs.
+class TraceRecorder {
+private:
+  TraceStorage storage;
+  uint8_t buffer[TRACE_BUFFER_SIZE];
+  size_t bufferLength;
+  size_t fileBytes;
+  bool recording;
+  unsigned long lastMillis;
+  unsigned long droppedEvents;
+  unsigned long unmarkedDrops; // Dropped since the last DROPPED marker
+
+  // Delta coding state for ADC codes, one slot per pin
+  int adcPins[TRACE_MAX_ADC_SLOTS];
+  int adcPrevious[TRACE_MAX_ADC_SLOTS];
+  int adcSlots;
+
+  bool append(const uint8_t *header, size_t headerLength, const uint8_t *payload, size_t payloadLength);
+  void recordDrop();
+  size_t encodeTimestamp(unsigned long now, uint8_t *out);
+  void recordSession(const AdcCalibration *calibration);
+  void recordData(int type, int arg, unsigned long now, const std::string &data);
+  void writeBuffer();
+  void stop(int reason);
+
+public:
+  TraceRecorder();
+
+  // Open a new trace and snapshot the calibration
+  bool begin(const AdcCalibration *calibration);
+
+  void recordAdc(int pin, int raw);
+  void recordTick(unsigned long now, int connectedCount);
+  void recordConnection(unsigned long now, int connectedCount);
+  void recordBleWrite(unsigned long now, int channel, const std::string &value);
+  void recordSerialCommand(unsigned long now, const std::string &command);
+
+  // Called once per loop(); writes the buffer out once it fills up
+  void flush();
+
+  // Serial retrieval of the current or previous boot's trace
+  bool beginDump(bool previous);
+  void continueDump();
+  bool isDumping() const;
+
+  bool isRecording() const;
+  size_t getFileBytes() const;
+  unsigned long getDroppedEvents() const;
+};
+
+#endif // TRACE_RECORDER_H
@@ -0,0 +1,100 @@
+#include "TraceStorage.h"
+#include <Arduino.h>
+#include <LittleFS.h>
+
+static File traceFile;
+static File dumpFile;
+
+TraceStorage::TraceStorage() {
+  dumping = false;
+  dumpRemaining = 0;
+  dumpSize = 0;
+}
+
+bool TraceStorage::begin() {
+  if (!LittleFS.begin(true)) {
+    Serial.println("Trace: filesystem mount failed");
+    return false;
+  }
+
+  // Field problems usually get reported after a power cycle, so keep the last boot
+  if (LittleFS.exists(TRACE_PREVIOUS_PATH)) {
+    LittleFS.remove(TRACE_PREVIOUS_PATH);
+  }
+  if (LittleFS.exists(TRACE_PATH)) {
+    LittleFS.rename(TRACE_PATH, TRACE_PREVIOUS_PATH);
+  }
+
+  traceFile = LittleFS.open(TRACE_PATH, FILE_WRITE);
+  if (!traceFile) {
+    Serial.println("Trace: could not open " TRACE_PATH);
+    return false;
+  }
+  return true;
+}
+
+size_t TraceStorage::write(const uint8_t *data, size_t length) {
+  if (!traceFile) {
+    return 0;
+  }
+
+  size_t written = traceFile.write(data, length);
+  traceFile.flush(); // Makes the data visible to a dump running alongside
+  return written;
+}
+
+void TraceStorage::close() {
+  traceFile.close();
+}
+
+bool TraceStorage::beginDump(bool previous) {
+  const char *path = previous ? TRACE_PREVIOUS_PATH : TRACE_PATH;
+  if (dumping) {
+    dumpFile.close();
+    dumping = false;
+  }
+
+  dumpFile = LittleFS.open(path, FILE_READ);
+  if (!dumpFile) {
+    Serial.println("TRACE NONE " + String(path));
+    return false;
+  }
+
+  // Only what is on flash now; the recorder keeps appending to the current trace
+  dumpSize = dumpFile.size();
+  dumpRemaining = dumpSize;
+  dumping = true;
+  Serial.println("TRACE BEGIN " + String(path) + " " + String((unsigned long)dumpSize));
+  return true;
+}
+
+void TraceStorage::continueDump() {
+  if (!dumping) {
+    return;
+  }
+
+  uint8_t chunk[TRACE_DUMP_CHUNK];
+  size_t length = dumpFile.read(chunk, min(dumpRemaining, (size_t)TRACE_DUMP_CHUNK));
+  if (length > 0) {
+    static const char digits[] = "0123456789abcdef";
+    char line[TRACE_DUMP_CHUNK * 2 + 1];
+    for (size_t i = 0; i < length; i++) {
+      line[i * 2] = digits[chunk[i] >> 4];
+      line[i * 2 + 1] = digits[chunk[i] & 0x0F];
+    }
+    line[length * 2] = '\0';
+    Serial.println(line);
+    dumpRemaining -= length;
+  }
+
+  // A short read means the file went away; the size check on the host catches it
+  if (length == 0 || dumpRemaining == 0) {
+    Serial.println("TRACE END " + String((unsigned long)(dumpSize - dumpRemaining)));
+    dumpFile.close();
+    dumping = false;
+  }
+}
+
+bool TraceStorage::isDumping() const {
+  return dumping;
+}
@@ -0,0 +1,38 @@
+#ifndef TRACE_STORAGE_H
+#define TRACE_STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRACE_PATH "/trace.bin"
+#define TRACE_PREVIOUS_PATH "/trace.prev.bin"
+#define TRACE_DUMP_CHUNK 48 // Trace bytes per hex line of a serial dump
+
+// Flash side of the trace recorder: keeps this boot's and the previous
+// boot's trace on LittleFS and streams either one out over the serial
+// console. A dump looks like
+//   TRACE BEGIN /trace.bin 1234
+//   <hex, TRACE_DUMP_CHUNK bytes per line>
+//   TRACE END 1234
+// and tools/replay/fetch_trace.py turns it back into a .bin file.
+class TraceStorage {
+private:
+  bool dumping;
+  size_t dumpRemaining;
+  size_t dumpSize;
+
+public:
+  TraceStorage();
+
+  // Mount the filesystem, rotate the previous trace and open a new one
+  bool begin();
+  size_t write(const uint8_t *data, size_t length);
+  void close();
+
+  // Start a dump of the current or previous trace; one chunk per continueDump()
+  bool beginDump(bool previous);
+  void continueDump();
+  bool isDumping() const;
+};
+
+#endif // TRACE_STORAGE_H
@@ -2,9 +2,12 @@
 #include "components/BatteryManager.h"
 #include "components/HeatingManager.h"
 #include "components/PowerManager.h"
+#include "components/CalibrationManager.h"
 #include "utils/BLEUtils.h"
 #include "components/Battery.h"
 #include "components/Temperature.h"
+#include "components/AdcCalibration.h"
+#include "components/TraceRecorder.h"
 class ServerCallbacks: public BLEServerCallbacks {
     void onDisconnect(BLEServer* pServer) {
         Serial.println("Client disconnected");
@@ -16,6 +19,9 @@ class ServerCallbacks: public BLEServerCallbacks {
 BatteryManager *batteryManager;
 HeatingManager *heatingManager;
 PowerManager *powerManager;
+CalibrationManager *calibrationManager;
+AdcCalibration *adcCalibration;
+TraceRecorder *traceRecorder;
 Battery *battery;
 Temperature *temperature;
 
@@ -45,6 +51,11 @@ const unsigned long BLE_CONNECTED_LED_DURATION = 5000;
 unsigned long bleConnectedTime = 0;
 bool wasDisconnected = true;
 
+// Input handling between ticks
+const size_t SERIAL_COMMAND_MAX_LENGTH = 32;
+std::string serialCommand;
+uint32_t lastConnectedCount = 0;
+
 unsigned long previousMillis = 0;
 unsigned long statusDisplayMillis = 0;
 const unsigned long STATUS_DISPLAY_INTERVAL = 1000; // Update display every second
@@ -64,9 +75,17 @@ void setup() {
   
   // ADC configuration
   analogReadResolution(12); // Set ADC resolution to 12 bits (0-4095)
+
+  // Raw code -> millivolt tables, one per ADC unit
+  adcCalibration = new AdcCalibration();
+  adcCalibration->begin();
+
+  // Record every control loop input from here on for host replay
+  traceRecorder = new TraceRecorder();
+  traceRecorder->begin(adcCalibration);
   
   // Initialize Battery and Temperature components with direct GPIO pins
-  battery = new Battery(BATTERY_PIN, BATTERY_VOLTAGE_DIVIDER,
+  battery = new Battery(BATTERY_PIN, adcCalibration, traceRecorder, BATTERY_VOLTAGE_DIVIDER,
                       BATTERY_VOLTAGE_MAX, BATTERY_VOLTAGE_MIN);
                       
   // Create lambda function to get battery voltage
@@ -75,7 +94,7 @@ void setup() {
   };
 
   // Then create temperature component with the callback
-  temperature = new Temperature(THERMISTOR_PIN,
+  temperature = new Temperature(THERMISTOR_PIN, adcCalibration, traceRecorder,
                              THERMISTOR_R_NOMINAL, THERMISTOR_B_COEFFICIENT,
                              THERMISTOR_SERIES_RESISTOR, REFERENCE_TEMP);
 
@@ -94,6 +113,8 @@ void setup() {
   batteryManager = new BatteryManager(pService, pServer);
   heatingManager = new HeatingManager(pService, pServer);
   powerManager = new PowerManager(pService, pServer);
+  calibrationManager = new CalibrationManager(pService, pServer, adcCalibration, traceRecorder,
+                                              BATTERY_PIN, THERMISTOR_PIN);
 
   batteryManager->setBatteryLevel(battPercent);
   batteryManager->setChargingStatus(false);
@@ -129,15 +150,71 @@ void setup() {
   Serial.println("System Initialized");
 }
 
+// Serial console commands (newline terminated):
+//   trace        dump this boot's trace, see tools/replay/fetch_trace.py
+//   trace prev   dump the previous boot's trace
+//   factory on   allow BLE calibration commands until "factory off" or reboot
+void handleSerialCommand(const std::string &command) {
+  if (command == "factory on") {
+    calibrationManager->setFactoryMode(true);
+  } else if (command == "factory off") {
+    calibrationManager->setFactoryMode(false);
+  } else if (command == "trace") {
+    traceRecorder->beginDump(false);
+  } else if (command == "trace prev") {
+    traceRecorder->beginDump(true);
+  }
+}
+
+// Applies the inputs that arrived since the last pass: connection changes,
+// BLE writes queued by the BLE task and serial commands. Running them here
+// keeps the BLE task free and puts every input in loop order, so each one is
+// recorded right before it is applied. tools/replay calls this directly for
+// recorded input events.
+void processInput(unsigned long currentMillis) {
+  uint32_t connectedCount = heatingManager->getServer()->getConnectedCount();
+  if (connectedCount != lastConnectedCount) {
+    lastConnectedCount = connectedCount;
+    traceRecorder->recordConnection(currentMillis, connectedCount);
+  }
+
+  std::string value;
+  while (heatingManager->takePendingWrite(value)) {
+    traceRecorder->recordBleWrite(currentMillis, TRACE_CHANNEL_HEATING, value);
+    heatingManager->handleWrite(value);
+  }
+  while (calibrationManager->takePendingWrite(value)) {
+    traceRecorder->recordBleWrite(currentMillis, TRACE_CHANNEL_CALIBRATION, value);
+    calibrationManager->handleWrite(value);
+  }
+
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\n') {
+      if (serialCommand.length() > 0) {
+        traceRecorder->recordSerialCommand(currentMillis, serialCommand);
+        handleSerialCommand(serialCommand);
+        serialCommand.clear();
+      }
+    } else if (c != '\r' && serialCommand.length() < SERIAL_COMMAND_MAX_LENGTH) {
+      serialCommand += c;
+    }
+  }
+}
+
 void loop() {
   unsigned long currentMillis = millis();
 
+  processInput(currentMillis);
+
   // Periodic sensor reading and control updates
   if (currentMillis - previousMillis >= UPDATE_INTERVAL) {
     previousMillis = currentMillis;
+    uint32_t connectedCount = heatingManager->getServer()->getConnectedCount();
+    traceRecorder->recordTick(currentMillis, connectedCount);
 
     // Simplified LED control - only handle BLE LED flashing
-    if (!heatingManager->getServer()->getConnectedCount()) {
+    if (!connectedCount) {
       // No BLE connection - flash BLE LED
       if (currentMillis - previousLEDMillis >= LED_FLASH_INTERVAL) {
         previousLEDMillis = currentMillis;
@@ -193,35 +270,60 @@ void loop() {
     // Log system status
     if (currentMillis - statusDisplayMillis >= STATUS_DISPLAY_INTERVAL) {
       statusDisplayMillis = currentMillis;
-      
-      // Clear screen and reset cursor position
-      Serial.print("\033[2J\033[H");
-      
-      // System title
-      Serial.println("SYSTEM STATUS");
-      Serial.println("-------------");
-      
-      // Temperature section
-      Serial.println("\nTEMPERATURE");
-      Serial.println("Current: " + String(currentTemp, 1) + "°C / " + String((currentTemp * 9/5) + 32, 1) + "°F");
-      Serial.println("Resistance: " + String(temperature->readResistance(), 2) + " Ohms");
-      Serial.println("Target:  " + String(targetTemp, 1) + "°C / " + String((targetTemp * 9/5) + 32, 1) + "°F");
-      Serial.println("Raw ADC: " + String(temperature->readRawValue()));
-      
-      // Battery section
-      Serial.println("\nBATTERY");
-      Serial.println("Level:   " + String(batteryPercent) + "% (" + String(batteryVoltage, 2) + "V)");
-      Serial.println("Raw ADC: " + String(battery->readRawValue()));
-      
-      // System status section
-      Serial.println("\nSYSTEM");
-      Serial.println("Heating: " + heatingManager->getHeatingStatus());
-      Serial.println("BLE:     " + String(heatingManager->getServer()->getConnectedCount() > 0 ? "Connected" : "Disconnected"));
-      
-      // Uptime
-      Serial.println("\nUptime: " + String(millis() / 1000) + " seconds");
+
+      // These reads are recorded, so they happen even while a trace dump
+      // holds the console back
+      float resistance = temperature->readResistance();
+      int temperatureRaw = temperature->readRawValue();
+      int batteryRaw = battery->readRawValue();
+
+      if (!traceRecorder->isDumping()) {
+        // Clear screen and reset cursor position
+        Serial.print("\033[2J\033[H");
+
+        // System title
+        Serial.println("SYSTEM STATUS");
+        Serial.println("-------------");
+
+        // Temperature section
+        Serial.println("\nTEMPERATURE");
+        Serial.println("Current: " + String(currentTemp, 1) + "°C / " + String((currentTemp * 9/5) + 32, 1) + "°F");
+        Serial.println("Resistance: " + String(resistance, 2) + " Ohms");
+        Serial.println("Target:  " + String(targetTemp, 1) + "°C / " + String((targetTemp * 9/5) + 32, 1) + "°F");
+        Serial.println("Raw ADC: " + String(temperatureRaw));
+
+        // Battery section
+        Serial.println("\nBATTERY");
+        Serial.println("Level:   " + String(batteryPercent) + "% (" + String(batteryVoltage, 2) + "V)");
+        Serial.println("Raw ADC: " + String(batteryRaw));
+
+        // ADC calibration section
+        Serial.println("\nADC CALIBRATION");
+        Serial.println("ADC1:    " + String(adcCalibration->getSource(ADC_CAL_UNIT_ADC1)) + " (" + String(adcCalibration->getPointCount(ADC_CAL_UNIT_ADC1)) + " points)");
+        Serial.println("ADC2:    " + String(adcCalibration->getSource(ADC_CAL_UNIT_ADC2)) + " (" + String(adcCalibration->getPointCount(ADC_CAL_UNIT_ADC2)) + " points)");
+        if (calibrationManager->isFactoryMode()) {
+          Serial.println("Factory mode: calibration commands enabled");
+        }
+
+        // System status section
+        Serial.println("\nSYSTEM");
+        Serial.println("Heating: " + heatingManager->getHeatingStatus());
+        Serial.println("BLE:     " + String(heatingManager->getServer()->getConnectedCount() > 0 ? "Connected" : "Disconnected"));
+
+        // Trace section
+        Serial.println("\nTRACE");
+        Serial.println("Logged:  " + String(traceRecorder->getFileBytes() / 1024) + " KB" + (traceRecorder->isRecording() ? "" : " (stopped)"));
+        Serial.println("Dropped: " + String(traceRecorder->getDroppedEvents()) + " events");
+
+        // Uptime
+        Serial.println("\nUptime: " + String(millis() / 1000) + " seconds");
+      }
     }
   }
 
+  // A dump goes out one line per pass so the control loop keeps running
+  traceRecorder->continueDump();
+  traceRecorder->flush();
+
   delay(10);
 }
@@ -0,0 +1,95 @@
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary layout of the control loop trace, shared by the on-device recorder
+// and the host replayer (tools/replay). Plain C++ only, no Arduino headers.
+//
+// The file starts with TRACE_MAGIC and TRACE_VERSION, followed by events.
+// Each event starts with one byte: the event type in the low nibble and a
+// small argument in the high nibble. Integers are LEB128 varints; signed
+// values are zigzag encoded first. Timestamps are millis() deltas from the
+// previous timestamped event.
+//
+//   SESSION    arg -            varint startMillis, then per ADC unit:
+//                               byte sourceLength, source, ADC_CAL_KNOTS varint
+//                               knots, byte pointCount, pointCount x (varint raw,
+//                               varint millivolts)
+//   TICK       arg connections  zigzag dt (connected client count at the tick)
+//   ADC        arg slot         zigzag (raw - previous raw on this slot)
+//   ADC_PIN    arg slot         byte pin (declares a slot before its first ADC)
+//   BLE_WRITE  arg channel      zigzag dt, varint length, bytes
+//   CONNECTION arg connections  zigzag dt (connected client count changed)
+//   SERIAL     arg -            zigzag dt, varint length, bytes (console command)
+//   DROPPED    arg -            varint count (events lost here; replay stops)
+//   END        arg reason       none (recorder stopped, see TRACE_END_*)
+//
+// ADC events carry no timestamp; they belong to the TICK, BLE_WRITE, SERIAL
+// or setup() phase that precedes them, in read order. BLE writes, connection
+// changes and serial commands are all applied by loop() between ticks.
+
+#define TRACE_MAGIC "FFTR"
+#define TRACE_MAGIC_LENGTH 4
+#define TRACE_VERSION 2
+
+#define TRACE_EVENT_SESSION 0
+#define TRACE_EVENT_TICK 1
+#define TRACE_EVENT_ADC 2
+#define TRACE_EVENT_ADC_PIN 3
+#define TRACE_EVENT_BLE_WRITE 4
+#define TRACE_EVENT_CONNECTION 5
+#define TRACE_EVENT_SERIAL 6
+#define TRACE_EVENT_DROPPED 7
+#define TRACE_EVENT_END 8
+
+// Why the recorder stopped (END arg)
+#define TRACE_END_SIZE_LIMIT 0
+
+#define TRACE_MAX_ADC_SLOTS 16
+#define TRACE_MAX_ARG 15
+
+// Writable characteristics whose writes are recorded
+#define TRACE_CHANNEL_HEATING 0
+#define TRACE_CHANNEL_CALIBRATION 1
+
+inline uint8_t traceEventByte(int type, int arg) {
+  if (arg > TRACE_MAX_ARG) arg = TRACE_MAX_ARG;
+  return (uint8_t)((arg << 4) | type);
+}
+
+inline uint32_t traceZigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+inline int32_t traceUnzigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Writes a varint into out (at least 5 bytes), returns the bytes used
+inline size_t traceEncodeVarint(uint32_t value, uint8_t *out) {
+  size_t length = 0;
+  while (value >= 0x80) {
+    out[length++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[length++] = (uint8_t)value;
+  return length;
+}
+
+// Reads a varint at *cursor, returns false if it runs past end
+inline bool traceDecodeVarint(const uint8_t **cursor, const uint8_t *end, uint32_t *value) {
+  uint32_t result = 0;
+  for (int shift = 0; shift < 35 && *cursor < end; shift += 7) {
+    uint8_t byte = *(*cursor)++;
+    result |= (uint32_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+#endif // TRACE_FORMAT_H
@@ -0,0 +1,275 @@
+#include "HostPlatform.h"
+#include <Preferences.h>
+#include <esp_adc_cal.h>
+#include <stdarg.h>
+#include <deque>
+#include "components/BLEWriteQueue.h"
+#include "components/TraceStorage.h"
+
+HostSerial Serial;
+
+unsigned long hostMillis = 0;
+uint32_t hostConnectedCount = 0;
+
+static int noAnalogInput(uint8_t pin) {
+  return 0;
+}
+
+int (*hostAnalogRead)(uint8_t pin) = noAnalogInput;
+
+std::string hostAdcSource[ADC_CAL_UNITS];
+uint16_t hostAdcKnots[ADC_CAL_UNITS][ADC_CAL_KNOTS];
+std::map<std::string, std::string> hostPreferences;
+const char *hostTracePath = NULL;
+std::vector<std::string> hostOutputs;
+
+static BLEServer *server;
+static BLEAdvertising advertising;
+static std::vector<BLECharacteristic *> characteristics;
+static std::map<std::string, std::string> publishedValues;
+static std::map<int, int> pinLevels;
+
+static void emit(const char *format, ...) {
+  char line[512];
+  int length = snprintf(line, sizeof(line), "%lu ", hostMillis);
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line + length, sizeof(line) - length, format, args);
+  va_end(args);
+  hostOutputs.push_back(line);
+}
+
+void hostSetIdealAdc() {
+  for (int unit = 0; unit < ADC_CAL_UNITS; unit++) {
+    hostAdcSource[unit] = "Ideal";
+    for (int i = 0; i < ADC_CAL_KNOTS; i++) {
+      hostAdcKnots[unit][i] = (uint32_t)std::min(i * ADC_CAL_KNOT_STEP, ADC_CAL_CODES - 1) * 3300 / ADC_CAL_CODES;
+    }
+  }
+}
+
+// ---- Arduino core ----
+
+unsigned long millis() {
+  return hostMillis;
+}
+
+void delay(unsigned long ms) {
+  // Time only moves when the driver says so
+}
+
+int analogRead(uint8_t pin) {
+  return hostAnalogRead(pin);
+}
+
+void analogReadResolution(uint8_t bits) {}
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  std::map<int, int>::iterator previous = pinLevels.find(pin);
+  if (previous == pinLevels.end() || previous->second != level) {
+    pinLevels[pin] = level;
+    emit("PIN %d %d", pin, level);
+  }
+}
+
+int hostPinLevel(int pin) {
+  std::map<int, int>::iterator level = pinLevels.find(pin);
+  return level == pinLevels.end() ? LOW : level->second;
+}
+
+// ---- BLE ----
+
+void BLECharacteristic::setValue(const char *data) {
+  value = data;
+  std::string &published = publishedValues[uuid];
+  if (published != value) {
+    published = value;
+    emit("BLE %s %s", uuid.c_str(), data);
+  }
+}
+
+BLECharacteristic *BLEService::createCharacteristic(const char *uuid, uint32_t properties) {
+  BLECharacteristic *characteristic = new BLECharacteristic(uuid);
+  characteristics.push_back(characteristic);
+  return characteristic;
+}
+
+BLEAdvertising *BLEServer::getAdvertising() {
+  return &advertising;
+}
+
+uint32_t BLEServer::getConnectedCount() {
+  return hostConnectedCount;
+}
+
+BLEServer *BLEDevice::createServer() {
+  server = new BLEServer();
+  return server;
+}
+
+BLEAdvertising *BLEDevice::getAdvertising() {
+  return &advertising;
+}
+
+BLEServer *hostServer() {
+  return server;
+}
+
+BLECharacteristic *hostFindCharacteristic(const char *uuid) {
+  for (size_t i = 0; i < characteristics.size(); i++) {
+    if (characteristics[i]->getUuid() == uuid) {
+      return characteristics[i];
+    }
+  }
+  return NULL;
+}
+
+// ---- NVS and ADC characterization ----
+
+bool Preferences::begin(const char *name, bool readOnly) {
+  // nvs_open() fails read-only on a namespace that was never written
+  return !(readOnly && hostPreferences.empty());
+}
+
+size_t Preferences::getBytes(const char *key, void *buffer, size_t maxLength) {
+  std::map<std::string, std::string>::iterator entry = hostPreferences.find(key);
+  if (entry == hostPreferences.end()) {
+    return 0;
+  }
+  // Like NVS, a value that does not fit is not read at all
+  if (entry->second.size() > maxLength) {
+    return 0;
+  }
+  memcpy(buffer, entry->second.data(), entry->second.size());
+  return entry->second.size();
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t length) {
+  hostPreferences[key].assign((const char *)value, length);
+  return length;
+}
+
+bool Preferences::remove(const char *key) {
+  return hostPreferences.erase(key) > 0;
+}
+
+bool Preferences::isKey(const char *key) {
+  return hostPreferences.count(key) > 0;
+}
+
+static int unitIndex(adc_unit_t adcNum) {
+  return adcNum == ADC_UNIT_1 ? ADC_CAL_UNIT_ADC1 : ADC_CAL_UNIT_ADC2;
+}
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adcNum, adc_atten_t atten, adc_bits_width_t bitWidth,
+                                             uint32_t defaultVref, esp_adc_cal_characteristics_t *chars) {
+  chars->adc_num = adcNum;
+  const std::string &source = hostAdcSource[unitIndex(adcNum)];
+  if (source == "eFuse Two Point") {
+    return ESP_ADC_CAL_VAL_EFUSE_TP;
+  }
+  if (source == "eFuse Vref") {
+    return ESP_ADC_CAL_VAL_EFUSE_VREF;
+  }
+  return ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adcReading, const esp_adc_cal_characteristics_t *chars) {
+  // AdcCalibration samples at every knot and at the top code
+  const uint16_t *knots = hostAdcKnots[unitIndex(chars->adc_num)];
+  if (adcReading >= ADC_CAL_CODES - 1) {
+    return knots[ADC_CAL_KNOTS - 1];
+  }
+  int knot = adcReading >> ADC_CAL_KNOT_SHIFT;
+  int fraction = adcReading & (ADC_CAL_KNOT_STEP - 1);
+  int lower = knots[knot];
+  int upper = knots[knot + 1];
+  return lower + ((upper - lower) * fraction) / ADC_CAL_KNOT_STEP;
+}
+
+// ---- Device-only components ----
+
+BLEWriteQueue::BLEWriteQueue() {
+  queue = new std::deque<std::string>();
+}
+
+bool BLEWriteQueue::push(const std::string &value) {
+  std::deque<std::string> *pending = (std::deque<std::string> *)queue;
+  if (value.length() > BLE_WRITE_MAX_LENGTH || pending->size() >= BLE_WRITE_QUEUE_DEPTH) {
+    return false;
+  }
+  pending->push_back(value);
+  return true;
+}
+
+bool BLEWriteQueue::pop(std::string &value) {
+  std::deque<std::string> *pending = (std::deque<std::string> *)queue;
+  if (pending->empty()) {
+    return false;
+  }
+  value = pending->front();
+  pending->pop_front();
+  return true;
+}
+
+static FILE *traceFile;
+
+TraceStorage::TraceStorage() : dumping(false), dumpRemaining(0), dumpSize(0) {}
+
+bool TraceStorage::begin() {
+  if (hostTracePath == NULL) {
+    return false;
+  }
+  traceFile = fopen(hostTracePath, "wb");
+  return traceFile != NULL;
+}
+
+size_t TraceStorage::write(const uint8_t *data, size_t length) {
+  if (traceFile == NULL) {
+    return 0;
+  }
+  size_t written = fwrite(data, 1, length, traceFile);
+  fflush(traceFile);
+  return written;
+}
+
+void TraceStorage::close() {
+  if (traceFile != NULL) {
+    fclose(traceFile);
+    traceFile = NULL;
+  }
+}
+
+// A dump of the current trace takes as many passes as on the device, so
+// isDumping() holds the console for the same ticks. Replay has no trace file,
+// like a device asked for a trace it does not have.
+bool TraceStorage::beginDump(bool previous) {
+  dumping = false;
+  FILE *file = (!previous && hostTracePath != NULL) ? fopen(hostTracePath, "rb") : NULL;
+  if (file == NULL) {
+    return false;
+  }
+  fseek(file, 0, SEEK_END);
+  dumpSize = ftell(file);
+  fclose(file);
+  dumpRemaining = dumpSize;
+  dumping = true;
+  return true;
+}
+
+void TraceStorage::continueDump() {
+  if (!dumping) {
+    return;
+  }
+  size_t length = std::min(dumpRemaining, (size_t)TRACE_DUMP_CHUNK);
+  dumpRemaining -= length;
+  if (length == 0 || dumpRemaining == 0) {
+    dumping = false;
+  }
+}
+
+bool TraceStorage::isDumping() const {
+  return dumping;
+}
@@ -0,0 +1,44 @@
+#ifndef HOST_PLATFORM_H
+#define HOST_PLATFORM_H
+
+// Host implementations of the platform APIs the firmware uses (Arduino core,
+// BLE, Preferences, esp_adc_cal) plus the device-only pieces BLEWriteQueue
+// and TraceStorage. The drivers (replay, record_test, adc_calibration_test)
+// set the inputs and read the captured outputs through these globals.
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "components/AdcCalibration.h"
+
+#define HOST_HEATING_UUID "4664c97b-ecc4-40c3-81a2-4789f8ed5e1c"
+#define HOST_CALIBRATION_UUID "b7c5e0a4-3f1d-4c8e-9a6b-2d4f8e1c7a53"
+
+// Inputs
+extern unsigned long hostMillis;
+extern uint32_t hostConnectedCount;
+extern int (*hostAnalogRead)(uint8_t pin);
+
+// esp_adc_cal characterization per AdcCalibration unit: source name and
+// the millivolts at every knot, interpolated in between
+extern std::string hostAdcSource[ADC_CAL_UNITS];
+extern uint16_t hostAdcKnots[ADC_CAL_UNITS][ADC_CAL_KNOTS];
+
+// Preferences contents (key -> bytes); an empty map is a missing namespace
+extern std::map<std::string, std::string> hostPreferences;
+
+// TraceStorage writes here; NULL leaves the recorder idle
+extern const char *hostTracePath;
+
+// Outputs, in order: "<ms> PIN <pin> <level>" and "<ms> BLE <uuid> <json>",
+// each only when the value changes
+extern std::vector<std::string> hostOutputs;
+
+int hostPinLevel(int pin); // Last digitalWrite() level, LOW if never written
+BLEServer *hostServer();
+BLECharacteristic *hostFindCharacteristic(const char *uuid);
+void hostSetIdealAdc(); // 3.3 V full scale, "Ideal" on both units
+
+#endif // HOST_PLATFORM_H
@@ -0,0 +1,301 @@
+// Host test for AdcCalibration: table construction, per-unit selection,
+// reference point handling and the NVS load path. Runs as part of
+// `make check`, and reports the lookup cost without judging it: wall-clock
+// limits fail at random on a loaded machine. Builds on the replay harness
+// (HostPlatform, this Makefile) for its Preferences and esp_adc_cal stubs.
+
+#include "HostPlatform.h"
+#include <chrono>
+
+#define BATTERY_PIN 32    // ADC1
+#define THERMISTOR_PIN 4  // ADC2
+
+static int failures = 0;
+
+#define CHECK(condition) check((condition), #condition, __LINE__)
+#define CHECK_EQUAL(expected, actual) checkEqual((expected), (actual), #actual, __LINE__)
+
+static void check(bool condition, const char *text, int line) {
+  if (!condition) {
+    fprintf(stderr, "adc_calibration_test:%d: check failed: %s\n", line, text);
+    failures++;
+  }
+}
+
+static void checkEqual(long expected, long actual, const char *text, int line) {
+  if (expected != actual) {
+    fprintf(stderr, "adc_calibration_test:%d: %s is %ld, expected %ld\n", line, text, actual, expected);
+    failures++;
+  }
+}
+
+static void storePoints(const char *key, const AdcCalPoint *points, int count) {
+  hostPreferences[key].assign((const char *)points, count * sizeof(AdcCalPoint));
+}
+
+// Linear characterizations that differ per unit, so a lookup on the wrong unit shows
+static void setLinearAdc() {
+  for (int i = 0; i < ADC_CAL_KNOTS; i++) {
+    int raw = std::min(i * ADC_CAL_KNOT_STEP, ADC_CAL_CODES - 1);
+    hostAdcKnots[ADC_CAL_UNIT_ADC1][i] = 100 + raw;
+    hostAdcKnots[ADC_CAL_UNIT_ADC2][i] = 200 + raw / 2;
+  }
+  hostAdcSource[ADC_CAL_UNIT_ADC1] = "eFuse Two Point";
+  hostAdcSource[ADC_CAL_UNIT_ADC2] = "eFuse Vref";
+}
+
+static AdcCalibration *beginCalibration() {
+  AdcCalibration *calibration = new AdcCalibration();
+  calibration->begin();
+  return calibration;
+}
+
+static void testIdealTable() {
+  AdcCalibration calibration;
+  for (int raw = 0; raw < ADC_CAL_CODES; raw++) {
+    long ideal = raw * 3300L / ADC_CAL_CODES;
+    CHECK(abs(calibration.toMillivolts(BATTERY_PIN, raw) - ideal) <= 1);
+    CHECK(abs(calibration.toMillivolts(THERMISTOR_PIN, raw) - ideal) <= 1);
+  }
+  CHECK_EQUAL(0, calibration.toMillivolts(BATTERY_PIN, -5));
+  CHECK_EQUAL(calibration.toMillivolts(BATTERY_PIN, ADC_CAL_CODES - 1),
+              calibration.toMillivolts(BATTERY_PIN, ADC_CAL_CODES + 100));
+}
+
+static void testUnitSelection() {
+  hostPreferences.clear();
+  setLinearAdc();
+  AdcCalibration *calibration = beginCalibration();
+
+  CHECK_EQUAL(ADC_CAL_UNIT_ADC1, AdcCalibration::unitForPin(32));
+  CHECK_EQUAL(ADC_CAL_UNIT_ADC1, AdcCalibration::unitForPin(39));
+  CHECK_EQUAL(ADC_CAL_UNIT_ADC2, AdcCalibration::unitForPin(4));
+  CHECK_EQUAL(ADC_CAL_UNIT_ADC2, AdcCalibration::unitForPin(15));
+
+  CHECK_EQUAL(1100, calibration->toMillivolts(BATTERY_PIN, 1000));
+  CHECK_EQUAL(700, calibration->toMillivolts(THERMISTOR_PIN, 1000));
+  CHECK(strcmp(calibration->getSource(ADC_CAL_UNIT_ADC1), "eFuse Two Point") == 0);
+  CHECK(strcmp(calibration->getSource(ADC_CAL_UNIT_ADC2), "eFuse Vref") == 0);
+
+  // A point corrects only the unit of the pin it was captured on
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(THERMISTOR_PIN, 1000, 750));
+  CHECK_EQUAL(0, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  CHECK_EQUAL(1, calibration->getPointCount(ADC_CAL_UNIT_ADC2));
+  CHECK_EQUAL(1100, calibration->toMillivolts(BATTERY_PIN, 1000));
+  CHECK_EQUAL(750, calibration->toMillivolts(THERMISTOR_PIN, 1000));
+  CHECK_EQUAL(250, calibration->toMillivolts(THERMISTOR_PIN, 0)); // Single point: constant offset
+  delete calibration;
+}
+
+static void testInterpolation() {
+  hostPreferences.clear();
+  setLinearAdc();
+  AdcCalibration *calibration = beginCalibration();
+
+  // Offsets +20 at 1000, -40 at 2000, +10 at 3000 on ADC1 (characterized 100 + raw)
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 2000, 2060));
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 1000, 1120));
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 3000, 3110));
+  CHECK_EQUAL(3, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+
+  const AdcCalPoint *points = calibration->getPoints(ADC_CAL_UNIT_ADC1);
+  CHECK_EQUAL(1000, points[0].raw);
+  CHECK_EQUAL(2000, points[1].raw);
+  CHECK_EQUAL(3000, points[2].raw);
+
+  // Exact at the points, linear offsets in between, nearest offset held outside
+  CHECK_EQUAL(1120, calibration->toMillivolts(BATTERY_PIN, 1000));
+  CHECK_EQUAL(2060, calibration->toMillivolts(BATTERY_PIN, 2000));
+  CHECK_EQUAL(3110, calibration->toMillivolts(BATTERY_PIN, 3000));
+  CHECK_EQUAL(1600 - 10, calibration->toMillivolts(BATTERY_PIN, 1500));
+  CHECK_EQUAL(2600 - 15, calibration->toMillivolts(BATTERY_PIN, 2500));
+  CHECK_EQUAL(100 + 20, calibration->toMillivolts(BATTERY_PIN, 0));
+  CHECK_EQUAL(3600 + 10, calibration->toMillivolts(BATTERY_PIN, 3500));
+
+  // Monotonic input, no jumps between segments
+  for (int raw = 1; raw < ADC_CAL_CODES; raw++) {
+    int step = calibration->toMillivolts(BATTERY_PIN, raw) - calibration->toMillivolts(BATTERY_PIN, raw - 1);
+    CHECK(step >= 0 && step <= 2);
+  }
+
+  // Clearing restores the characterization on both units
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(THERMISTOR_PIN, 500, 500));
+  calibration->clearPoints();
+  CHECK_EQUAL(0, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  CHECK_EQUAL(0, calibration->getPointCount(ADC_CAL_UNIT_ADC2));
+  CHECK_EQUAL(1600, calibration->toMillivolts(BATTERY_PIN, 1500));
+  CHECK_EQUAL(450, calibration->toMillivolts(THERMISTOR_PIN, 500));
+  delete calibration;
+}
+
+static void testReplaceAndLimit() {
+  hostPreferences.clear();
+  setLinearAdc();
+  AdcCalibration *calibration = beginCalibration();
+
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 1000, 1120));
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 1000, 1090));
+  CHECK_EQUAL(1, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  CHECK_EQUAL(1090, calibration->toMillivolts(BATTERY_PIN, 1000));
+
+  for (int i = 1; i < ADC_CAL_MAX_POINTS; i++) {
+    CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 1000 + i * 100, 1100 + i * 100));
+  }
+  CHECK_EQUAL(ADC_CAL_MAX_POINTS, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+
+  // Full: a new code is refused, an existing one can still be replaced
+  CHECK_EQUAL(ADC_CAL_POINT_TABLE_FULL, calibration->addPoint(BATTERY_PIN, 3000, 3100));
+  CHECK_EQUAL(ADC_CAL_MAX_POINTS, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 1200, 1290));
+  CHECK_EQUAL(1290, calibration->toMillivolts(BATTERY_PIN, 1200));
+
+  // The other unit has its own budget
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(THERMISTOR_PIN, 3500, 2000));
+
+  CHECK_EQUAL(ADC_CAL_POINT_INVALID, calibration->addPoint(BATTERY_PIN, -1, 100));
+  CHECK_EQUAL(ADC_CAL_POINT_INVALID, calibration->addPoint(BATTERY_PIN, ADC_CAL_CODES, 100));
+  CHECK_EQUAL(ADC_CAL_POINT_INVALID, calibration->addPoint(BATTERY_PIN, 100, -1));
+  CHECK_EQUAL(ADC_CAL_POINT_INVALID, calibration->addPoint(BATTERY_PIN, 3250, ADC_CAL_MAX_MILLIVOLTS + 1));
+  delete calibration;
+}
+
+static void testImplausiblePoint() {
+  hostPreferences.clear();
+  setLinearAdc();
+  AdcCalibration *calibration = beginCalibration();
+
+  // The battery voltage before the divider instead of the pin voltage
+  CHECK_EQUAL(ADC_CAL_POINT_IMPLAUSIBLE, calibration->addPoint(BATTERY_PIN, 2000, 3300));
+  CHECK_EQUAL(ADC_CAL_POINT_IMPLAUSIBLE, calibration->addPoint(BATTERY_PIN, 1000, 1100 - ADC_CAL_MAX_CORRECTION - 1));
+  CHECK_EQUAL(0, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  CHECK_EQUAL(2100, calibration->toMillivolts(BATTERY_PIN, 2000));
+
+  // Judged against the pin's own unit
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 1000, 1100 + ADC_CAL_MAX_CORRECTION));
+  CHECK_EQUAL(ADC_CAL_POINT_IMPLAUSIBLE, calibration->addPoint(THERMISTOR_PIN, 1000, 1100));
+  delete calibration;
+}
+
+static void testStoredPoints() {
+  setLinearAdc();
+  AdcCalibration *calibration;
+
+  // Uncalibrated board: the namespace does not exist
+  hostPreferences.clear();
+  calibration = beginCalibration();
+  CHECK_EQUAL(0, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  CHECK_EQUAL(0, calibration->getPointCount(ADC_CAL_UNIT_ADC2));
+  CHECK_EQUAL(1100, calibration->toMillivolts(BATTERY_PIN, 1000));
+  delete calibration;
+
+  // Save and load round trip, one key per unit
+  calibration = beginCalibration();
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 1000, 1120));
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 3000, 3110));
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(THERMISTOR_PIN, 800, 610));
+  CHECK(calibration->savePoints());
+  delete calibration;
+  CHECK_EQUAL(2 * sizeof(AdcCalPoint), hostPreferences["points1"].size());
+  CHECK_EQUAL(1 * sizeof(AdcCalPoint), hostPreferences["points2"].size());
+
+  calibration = beginCalibration();
+  CHECK_EQUAL(2, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  CHECK_EQUAL(1, calibration->getPointCount(ADC_CAL_UNIT_ADC2));
+  CHECK_EQUAL(2100 + 15, calibration->toMillivolts(BATTERY_PIN, 2000)); // +20 to +10 across 1000..3000
+  CHECK_EQUAL(610, calibration->toMillivolts(THERMISTOR_PIN, 800));
+
+  // Clearing and saving removes the keys
+  calibration->clearPoints();
+  CHECK(calibration->savePoints());
+  CHECK(hostPreferences.empty());
+  delete calibration;
+
+  // Unsorted table on one unit: that unit falls back, the other still loads
+  AdcCalPoint unsorted[] = {{2000, 2060}, {1000, 1120}};
+  AdcCalPoint good[] = {{800, 610}};
+  storePoints("points1", unsorted, 2);
+  storePoints("points2", good, 1);
+  calibration = beginCalibration();
+  CHECK_EQUAL(0, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  CHECK_EQUAL(1100, calibration->toMillivolts(BATTERY_PIN, 1000));
+  CHECK_EQUAL(1, calibration->getPointCount(ADC_CAL_UNIT_ADC2));
+  delete calibration;
+
+  // Duplicate code
+  AdcCalPoint duplicate[] = {{1000, 1120}, {1000, 1130}};
+  hostPreferences.clear();
+  storePoints("points1", duplicate, 2);
+  calibration = beginCalibration();
+  CHECK_EQUAL(0, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  delete calibration;
+
+  // Code out of range
+  AdcCalPoint outOfRange[] = {{1000, 1120}, {ADC_CAL_CODES, 3000}};
+  hostPreferences.clear();
+  storePoints("points1", outOfRange, 2);
+  calibration = beginCalibration();
+  CHECK_EQUAL(0, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  delete calibration;
+
+  // More points than fit: NVS refuses the read
+  AdcCalPoint tooMany[ADC_CAL_MAX_POINTS + 1];
+  for (int i = 0; i <= ADC_CAL_MAX_POINTS; i++) {
+    tooMany[i].raw = 100 + i * 100;
+    tooMany[i].millivolts = 200 + i * 100;
+  }
+  hostPreferences.clear();
+  storePoints("points1", tooMany, ADC_CAL_MAX_POINTS + 1);
+  calibration = beginCalibration();
+  CHECK_EQUAL(0, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  delete calibration;
+
+  // Length that is not a whole number of points
+  hostPreferences.clear();
+  storePoints("points1", good, 1);
+  hostPreferences["points1"] += '\x01';
+  calibration = beginCalibration();
+  CHECK_EQUAL(0, calibration->getPointCount(ADC_CAL_UNIT_ADC1));
+  delete calibration;
+
+  hostPreferences.clear();
+}
+
+// The read path is a single table lookup; report what one costs here
+static void reportLookupCost() {
+  AdcCalibration *calibration = beginCalibration();
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 1000, 1120));
+  CHECK_EQUAL(ADC_CAL_POINT_ADDED, calibration->addPoint(BATTERY_PIN, 3000, 3110));
+
+  const int rounds = 2000;
+  volatile uint32_t sink = 0;
+  std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; round++) {
+    uint32_t sum = 0;
+    for (int raw = 0; raw < ADC_CAL_CODES; raw++) {
+      sum += calibration->toMillivolts(round & 1 ? BATTERY_PIN : THERMISTOR_PIN, raw ^ round);
+    }
+    sink = sink + sum;
+  }
+  double nanos = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+  double perLookup = nanos / ((double)rounds * ADC_CAL_CODES);
+
+  fprintf(stderr, "adc_calibration_test: %.2f ns per lookup\n", perLookup);
+  delete calibration;
+}
+
+int main() {
+  testIdealTable();
+  testUnitSelection();
+  testInterpolation();
+  testReplaceAndLimit();
+  testImplausiblePoint();
+  testStoredPoints();
+  reportLookupCost();
+
+  if (failures > 0) {
+    fprintf(stderr, "adc_calibration_test: %d failed\n", failures);
+    return 1;
+  }
+  fprintf(stderr, "adc_calibration_test: passed\n");
+  return 0;
+}
@@ -0,0 +1,83 @@
+#!/usr/bin/env python3
+"""Fetch a control loop trace from a device over the serial console.
+
+    python3 tools/replay/fetch_trace.py /dev/cu.usbserial-0001 trace.bin
+    python3 tools/replay/fetch_trace.py --previous /dev/cu.usbserial-0001 trace.bin
+
+Sends the `trace` (or `trace prev`) console command and decodes the hex dump
+the firmware prints between "TRACE BEGIN" and "TRACE END" (see
+src/components/TraceStorage.h). Needs pyserial. Close any serial monitor
+first. The port is opened with DTR/RTS released so the board does not reset;
+if it resets anyway, the trace of interest has been rotated to the previous
+slot and --previous fetches it.
+"""
+
+import argparse
+import sys
+import time
+
+import serial
+
+
+def fetch(port, previous, begin_timeout):
+    console = serial.Serial()
+    console.port = port
+    console.baudrate = 115200
+    console.timeout = 5
+    console.dtr = False
+    console.rts = False
+    console.open()
+
+    try:
+        console.reset_input_buffer()
+        console.write(b"trace prev\n" if previous else b"trace\n")
+
+        deadline = time.time() + begin_timeout
+        size = None
+        while size is None:
+            if time.time() > deadline:
+                raise RuntimeError("no TRACE BEGIN from the device")
+            line = console.readline().decode("ascii", "replace").strip()
+            if line.startswith("TRACE NONE"):
+                raise RuntimeError("device has no %s" % line.split()[-1])
+            if line.startswith("TRACE BEGIN"):
+                size = int(line.split()[-1])
+
+        data = bytearray()
+        while True:
+            line = console.readline().decode("ascii", "replace").strip()
+            if not line:
+                raise RuntimeError("dump stalled after %d of %d bytes" % (len(data), size))
+            if line.startswith("TRACE END"):
+                break
+            data.extend(bytes.fromhex(line))
+            sys.stderr.write("\r%d / %d bytes" % (len(data), size))
+        sys.stderr.write("\n")
+
+        if len(data) != size:
+            raise RuntimeError("got %d bytes, device announced %d" % (len(data), size))
+        return bytes(data)
+    finally:
+        console.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("port", help="serial port of the device")
+    parser.add_argument("output", help="where to write the trace")
+    parser.add_argument("--previous", action="store_true", help="fetch the previous boot's trace")
+    parser.add_argument("--timeout", type=float, default=10, help="seconds to wait for the dump to start")
+    args = parser.parse_args()
+
+    try:
+        data = fetch(args.port, args.previous, args.timeout)
+    except (RuntimeError, ValueError, serial.SerialException) as error:
+        sys.exit("fetch_trace: %s" % error)
+
+    with open(args.output, "wb") as output:
+        output.write(data)
+    print("wrote %d bytes to %s" % (len(data), args.output))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,187 @@
+// Round-trip test for the trace recorder: runs the firmware on the host
+// against a simulated boot (heater and thermistor, draining battery, BLE
+// client, factory calibration and trace fetches over the console) with the
+// real TraceRecorder.cpp writing the trace. The run ends when the recorder
+// stops at its file size limit, which the Makefile sets small. The outputs of
+// the live run are written next to the trace; replaying the trace must
+// reproduce them exactly (`make check` does both).
+//
+// Usage:
+//   record_test trace.bin outputs.expected
+
+#include "HostPlatform.h"
+#include "components/TraceRecorder.h"
+
+// Firmware entry points and state from src/main.cpp
+void setup();
+void loop();
+extern TraceRecorder *traceRecorder;
+
+#define RECORD_LOOP_MILLIS 10                 // loop() ends in delay(10)
+#define RECORD_MAX_MILLIS (4UL * 3600 * 1000) // Give up if the recorder never stops
+
+// Pins and circuit constants as configured in src/main.cpp
+#define HEATING_PIN 15
+#define THERMISTOR_PIN 4
+#define BATTERY_PIN 32
+#define SERIES_RESISTOR 50000.0
+#define DIVIDER_RATIO 3.921
+
+// Simulated hardware
+static double temperatureC = 12.0;
+static double batteryVolts = 8.3;
+static uint32_t noiseState = 12345;
+
+// Deterministic noise of a few codes, the same on every host
+static int noise() {
+  noiseState = noiseState * 1103515245 + 12345;
+  return (int)((noiseState >> 16) % 7) - 3;
+}
+
+// Inverse of the unit's characterization: the code that reads as millivolts
+static int rawForMillivolts(int unit, double millivolts) {
+  const uint16_t *knots = hostAdcKnots[unit];
+  for (int knot = 0; knot < ADC_CAL_KNOTS - 1; knot++) {
+    if (millivolts <= knots[knot + 1]) {
+      double fraction = (millivolts - knots[knot]) / (double)(knots[knot + 1] - knots[knot]);
+      int raw = knot * ADC_CAL_KNOT_STEP + (int)(fraction * ADC_CAL_KNOT_STEP);
+      return constrain(raw, 0, ADC_CAL_CODES - 1);
+    }
+  }
+  return ADC_CAL_CODES - 1;
+}
+
+static int simulatedAnalogRead(uint8_t pin) {
+  double millivolts;
+  if (pin == THERMISTOR_PIN) {
+    double kelvin = temperatureC + 273.15;
+    double resistance = 10000.0 * exp(3950.0 * (1.0 / kelvin - 1.0 / 298.15));
+    millivolts = 3300.0 * resistance / (resistance + SERIES_RESISTOR);
+  } else if (pin == BATTERY_PIN) {
+    millivolts = batteryVolts / DIVIDER_RATIO * 1000.0;
+  } else {
+    millivolts = 0;
+  }
+  int raw = rawForMillivolts(AdcCalibration::unitForPin(pin), millivolts) + noise();
+  return constrain(raw, 0, ADC_CAL_CODES - 1);
+}
+
+// A unit with two-point eFuse data on ADC1 and Vref-only data on ADC2, and
+// one factory point stored for ADC1
+static void setUpCalibration() {
+  for (int i = 0; i < ADC_CAL_KNOTS; i++) {
+    int raw = std::min(i * ADC_CAL_KNOT_STEP, ADC_CAL_CODES - 1);
+    hostAdcKnots[ADC_CAL_UNIT_ADC1][i] = 142 + raw * 3020 / (ADC_CAL_CODES - 1);
+    hostAdcKnots[ADC_CAL_UNIT_ADC2][i] = 128 + raw * 3105 / (ADC_CAL_CODES - 1) - (raw * (4095 - raw)) / 40000;
+  }
+  hostAdcSource[ADC_CAL_UNIT_ADC1] = "eFuse Two Point";
+  hostAdcSource[ADC_CAL_UNIT_ADC2] = "eFuse Vref";
+
+  AdcCalPoint point = {2500, 2000};
+  hostPreferences["points1"].assign((const char *)&point, sizeof(point));
+}
+
+static void bleWrite(const char *uuid, const char *value) {
+  hostFindCharacteristic(uuid)->write(value);
+}
+
+static void setConnected(bool connected) {
+  BLEServerCallbacks *callbacks = hostServer()->getCallbacks();
+  // The stack updates the count before calling back
+  hostConnectedCount = connected ? 1 : 0;
+  if (connected) {
+    callbacks->onConnect(hostServer());
+  } else {
+    callbacks->onDisconnect(hostServer());
+  }
+}
+
+// Scripted inputs, each delivered between two loop() passes like the BLE task would
+static void deliverInputs(unsigned long now) {
+  switch (now) {
+    case 3000: setConnected(true); break;
+    case 10000: bleWrite(HOST_HEATING_UUID, "{\"targetTemperature\":28}"); break;
+    // The thermistor divider sits near 820 mV at this point of the run
+    case 40000: bleWrite(HOST_CALIBRATION_UUID, "{\"command\":\"capture\",\"pin\":4,\"millivolts\":820}"); break;
+    case 41000: Serial.input += "factory on\n"; break;
+    case 42000: bleWrite(HOST_CALIBRATION_UUID, "{\"command\":\"capture\",\"pin\":4,\"millivolts\":820}"); break;
+    case 43000: bleWrite(HOST_CALIBRATION_UUID, "{\"command\":\"capture\",\"pin\":15,\"millivolts\":820}"); break;
+    // Battery side voltage, then a reference far from the ~2120 mV on the pin
+    case 43500: bleWrite(HOST_CALIBRATION_UUID, "{\"command\":\"capture\",\"pin\":32,\"millivolts\":8300}"); break;
+    case 43700: bleWrite(HOST_CALIBRATION_UUID, "{\"command\":\"capture\",\"pin\":32,\"millivolts\":1200}"); break;
+    case 44000: Serial.input += "factory off\n"; break;
+    case 120000: setConnected(false); break;
+    case 180000: setConnected(true); break;
+    case 181000: bleWrite(HOST_HEATING_UUID, "{\"targetTemperature\":12}"); break;
+    case 181005: bleWrite(HOST_HEATING_UUID, "{\"targetTemperature\":14}"); break;
+    // Fetches over the console; later dumps are long enough to span ticks
+    case 200000: Serial.input += "trace\n"; break;
+    case 260000: Serial.input += "trace prev\n"; break;
+    case 500000: Serial.input += "trace\n"; break;
+    case 700000: Serial.input += "trace\n"; break;
+    default: break;
+  }
+}
+
+// One simulated second of heater, room and battery
+static void stepPhysics() {
+  bool heating = hostPinLevel(HEATING_PIN) == HIGH;
+  temperatureC += heating ? 0.08 : (10.0 - temperatureC) * 0.004;
+  batteryVolts -= heating ? 0.0004 : 0.00005;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s trace.bin outputs.expected\n", argv[0]);
+    return 2;
+  }
+
+  hostTracePath = argv[1];
+  hostAnalogRead = simulatedAnalogRead;
+  setUpCalibration();
+
+  setup();
+  if (!traceRecorder->isRecording()) {
+    fprintf(stderr, "record_test: recorder did not start\n");
+    return 1;
+  }
+
+  // Stop right after the pass that hit the size limit, so the live outputs
+  // cover exactly what the trace holds
+  unsigned long dumpTicks = 0;
+  while (traceRecorder->isRecording()) {
+    hostMillis += RECORD_LOOP_MILLIS;
+    if (hostMillis > RECORD_MAX_MILLIS) {
+      fprintf(stderr, "record_test: recorder still running after %lu ms\n", hostMillis);
+      return 1;
+    }
+    if (hostMillis % 1000 == 0) {
+      stepPhysics();
+    }
+    deliverInputs(hostMillis);
+    if (hostMillis % 1000 == 0 && traceRecorder->isDumping()) {
+      dumpTicks++;
+    }
+    loop();
+  }
+
+  // Replay has no dump running, so ticks under a dump must record the same inputs
+  if (dumpTicks == 0) {
+    fprintf(stderr, "record_test: no tick ran during a trace dump\n");
+    return 1;
+  }
+
+  FILE *outputs = fopen(argv[2], "w");
+  if (outputs == NULL) {
+    fprintf(stderr, "record_test: cannot write %s\n", argv[2]);
+    return 1;
+  }
+  for (size_t i = 0; i < hostOutputs.size(); i++) {
+    fprintf(outputs, "%s\n", hostOutputs[i].c_str());
+  }
+  fclose(outputs);
+
+  fprintf(stderr, "record_test: %lu ms recorded, %u trace bytes, %lu dropped, %lu ticks under a dump\n",
+          hostMillis, (unsigned)traceRecorder->getFileBytes(), traceRecorder->getDroppedEvents(), dumpTicks);
+  return traceRecorder->getDroppedEvents() == 0 ? 0 : 1;
+}
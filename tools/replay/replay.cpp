@@ -0,0 +1,280 @@
+// Replays a control loop trace recorded by TraceRecorder through the
+// unmodified firmware (setup()/loop(), components and BLE publishing) on the
+// host. Time only advances to the next recorded event, so hours of trace run
+// in seconds. Every BLE value and pin level change is printed; given an
+// expected output file the run is diffed against it instead, which is how a
+// corpus of field traces is kept as a regression suite. Build with the
+// Makefile next to this file (see README.md).
+//
+// Usage:
+//   replay trace.bin > trace.expected   Record the outputs of a known-good build
+//   replay trace.bin trace.expected     Diff against them; exit 1 on mismatch
+// Exit 2 means the trace is unreadable or the firmware diverged from it, and
+// exit 3 that the recorder dropped events, so only the part before them ran.
+
+#include "HostPlatform.h"
+#include <stdarg.h>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include "utils/TraceFormat.h"
+
+// Firmware entry points from src/main.cpp
+void setup();
+void loop();
+void processInput(unsigned long currentMillis);
+
+// Trace being replayed
+static std::vector<uint8_t> trace;
+static const uint8_t *cursor;
+static const uint8_t *traceEnd;
+
+// ADC delta decoding state, one slot per pin
+static int adcPins[TRACE_MAX_ADC_SLOTS];
+static int adcPrevious[TRACE_MAX_ADC_SLOTS];
+
+static void fail(int status, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  fprintf(stderr, "replay: at %lu ms (offset %ld): ", hostMillis, (long)(cursor - trace.data()));
+  vfprintf(stderr, format, args);
+  fprintf(stderr, "\n");
+  va_end(args);
+  exit(status);
+}
+
+static uint8_t readByte() {
+  if (cursor >= traceEnd) {
+    fail(2, "trace truncated");
+  }
+  return *cursor++;
+}
+
+static uint32_t readVarint() {
+  uint32_t value;
+  if (!traceDecodeVarint(&cursor, traceEnd, &value)) {
+    fail(2, "trace truncated inside a varint");
+  }
+  return value;
+}
+
+static std::string readData(const char *what) {
+  uint32_t length = readVarint();
+  if ((uint32_t)(traceEnd - cursor) < length) {
+    fail(2, "trace truncated inside %s", what);
+  }
+  std::string data((const char *)cursor, length);
+  cursor += length;
+  return data;
+}
+
+static void advanceClock() {
+  hostMillis += traceUnzigzag(readVarint());
+}
+
+static int traceAnalogRead(uint8_t pin) {
+  while (true) {
+    if (cursor >= traceEnd) {
+      fail(2, "firmware read pin %d past the end of the trace (diverged)", pin);
+    }
+
+    int type = *cursor & 0x0F;
+    int slot = *cursor >> 4;
+    if (type == TRACE_EVENT_ADC_PIN) {
+      cursor++;
+      adcPins[slot] = readByte();
+      adcPrevious[slot] = 0;
+      continue;
+    }
+    if (type == TRACE_EVENT_DROPPED) {
+      fail(3, "recorder dropped events where the firmware read pin %d; replay cannot continue", pin);
+    }
+    if (type != TRACE_EVENT_ADC) {
+      fail(2, "firmware read pin %d where the trace has no read (diverged)", pin);
+    }
+
+    cursor++;
+    if (adcPins[slot] != pin) {
+      fail(2, "firmware read pin %d, trace recorded pin %d (diverged)", pin, adcPins[slot]);
+    }
+    adcPrevious[slot] += traceUnzigzag(readVarint());
+    return adcPrevious[slot];
+  }
+}
+
+static void readSession() {
+  if ((readByte() & 0x0F) != TRACE_EVENT_SESSION) {
+    fail(2, "trace does not start with a session event");
+  }
+
+  hostMillis = readVarint();
+
+  for (int unit = 0; unit < ADC_CAL_UNITS; unit++) {
+    size_t sourceLength = readByte();
+    if ((size_t)(traceEnd - cursor) < sourceLength) {
+      fail(2, "trace truncated inside the session event");
+    }
+    hostAdcSource[unit].assign((const char *)cursor, sourceLength);
+    cursor += sourceLength;
+
+    for (int i = 0; i < ADC_CAL_KNOTS; i++) {
+      hostAdcKnots[unit][i] = readVarint();
+    }
+
+    int pointCount = readByte();
+    if (pointCount > ADC_CAL_MAX_POINTS) {
+      fail(2, "session has %d calibration points, at most %d supported", pointCount, ADC_CAL_MAX_POINTS);
+    }
+    std::vector<AdcCalPoint> points;
+    for (int i = 0; i < pointCount; i++) {
+      AdcCalPoint point;
+      point.raw = readVarint();
+      point.millivolts = readVarint();
+      points.push_back(point);
+    }
+    // Served back to AdcCalibration::begin() under its NVS key
+    if (pointCount > 0) {
+      const char *key = unit == ADC_CAL_UNIT_ADC1 ? "points1" : "points2";
+      hostPreferences[key].assign((const char *)points.data(), points.size() * sizeof(AdcCalPoint));
+    }
+  }
+}
+
+static BLECharacteristic *findCharacteristic(int channel) {
+  if (channel == TRACE_CHANNEL_HEATING) {
+    return hostFindCharacteristic(HOST_HEATING_UUID);
+  }
+  if (channel == TRACE_CHANNEL_CALIBRATION) {
+    return hostFindCharacteristic(HOST_CALIBRATION_UUID);
+  }
+  return NULL;
+}
+
+static int compareOutputs(const char *expectedPath) {
+  std::ifstream file(expectedPath);
+  if (!file) {
+    fprintf(stderr, "replay: cannot open %s\n", expectedPath);
+    return 2;
+  }
+
+  std::string expected;
+  size_t line = 0;
+  while (std::getline(file, expected)) {
+    if (line >= hostOutputs.size()) {
+      fprintf(stderr, "replay: output ends early at line %zu\n  expected: %s\n", line + 1, expected.c_str());
+      return 1;
+    }
+    if (expected != hostOutputs[line]) {
+      fprintf(stderr, "replay: output differs at line %zu\n  expected: %s\n  actual:   %s\n",
+              line + 1, expected.c_str(), hostOutputs[line].c_str());
+      return 1;
+    }
+    line++;
+  }
+
+  if (line < hostOutputs.size()) {
+    fprintf(stderr, "replay: unexpected output at line %zu\n  actual:   %s\n", line + 1, hostOutputs[line].c_str());
+    return 1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "usage: %s trace.bin [expected.txt]\n", argv[0]);
+    return 2;
+  }
+
+  std::ifstream file(argv[1], std::ios::binary);
+  if (!file) {
+    fprintf(stderr, "replay: cannot open %s\n", argv[1]);
+    return 2;
+  }
+  trace.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+  cursor = trace.data();
+  traceEnd = trace.data() + trace.size();
+  if (trace.size() < TRACE_MAGIC_LENGTH + 1 || memcmp(cursor, TRACE_MAGIC, TRACE_MAGIC_LENGTH) != 0) {
+    fail(2, "not a trace file");
+  }
+  if (cursor[TRACE_MAGIC_LENGTH] != TRACE_VERSION) {
+    fail(2, "trace version %d, replayer understands %d", cursor[TRACE_MAGIC_LENGTH], TRACE_VERSION);
+  }
+  cursor += TRACE_MAGIC_LENGTH + 1;
+
+  for (int i = 0; i < TRACE_MAX_ADC_SLOTS; i++) {
+    adcPins[i] = -1;
+  }
+  hostAnalogRead = traceAnalogRead;
+
+  std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+  readSession();
+  unsigned long startMillis = hostMillis;
+  unsigned long ticks = 0;
+  unsigned long writes = 0;
+  bool incomplete = false;
+
+  setup();
+
+  while (cursor < traceEnd) {
+    uint8_t event = readByte();
+    int type = event & 0x0F;
+    int arg = event >> 4;
+
+    if (type == TRACE_EVENT_TICK) {
+      advanceClock();
+      hostConnectedCount = arg;
+      loop();
+      ticks++;
+    } else if (type == TRACE_EVENT_BLE_WRITE) {
+      advanceClock();
+      std::string data = readData("a BLE write");
+      BLECharacteristic *characteristic = findCharacteristic(arg);
+      if (characteristic == NULL) {
+        fail(2, "BLE write on unknown channel %d", arg);
+      }
+      // Queued by the characteristic callback, applied by loop()'s input pass
+      characteristic->write(data);
+      processInput(hostMillis);
+      writes++;
+    } else if (type == TRACE_EVENT_CONNECTION) {
+      advanceClock();
+      hostConnectedCount = arg;
+      processInput(hostMillis);
+    } else if (type == TRACE_EVENT_SERIAL) {
+      advanceClock();
+      Serial.input = readData("a serial command") + "\n";
+      processInput(hostMillis);
+    } else if (type == TRACE_EVENT_DROPPED) {
+      fprintf(stderr, "replay: recorder dropped %lu events at %lu ms; replayed up to there\n",
+              (unsigned long)readVarint(), hostMillis);
+      incomplete = true;
+      break;
+    } else if (type == TRACE_EVENT_END) {
+      fprintf(stderr, "replay: recorder stopped at %lu ms (%s)\n", hostMillis,
+              arg == TRACE_END_SIZE_LIMIT ? "file size limit" : "unknown reason");
+      break;
+    } else if (type == TRACE_EVENT_ADC || type == TRACE_EVENT_ADC_PIN) {
+      cursor--;
+      fail(2, "trace has ADC reads the firmware did not make (diverged)");
+    } else {
+      cursor--;
+      fail(2, "unknown event type %d", type);
+    }
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+  fprintf(stderr, "replay: %lu ticks, %lu BLE writes, %.2f h of trace in %.3f s\n",
+          ticks, writes, (hostMillis - startMillis) / 3600000.0, seconds);
+
+  int result = 0;
+  if (argc == 3) {
+    result = compareOutputs(argv[2]);
+  } else {
+    for (size_t i = 0; i < hostOutputs.size(); i++) {
+      printf("%s\n", hostOutputs[i].c_str());
+    }
+  }
+  // Lost events are not a divergence, but the run did not cover the whole trace
+  return result == 0 && incomplete ? 3 : result;
+}
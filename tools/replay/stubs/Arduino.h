@@ -0,0 +1,91 @@
+#ifndef ARDUINO_H
+#define ARDUINO_H
+
+// Host stand-in for the Arduino core: just enough to build the firmware
+// sources for tools/replay. Inputs come from the host drivers, outputs are
+// captured.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::abs;
+using std::max;
+using std::min;
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x03
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+enum gpio_num_t {
+  GPIO_NUM_0 = 0, GPIO_NUM_1, GPIO_NUM_2, GPIO_NUM_3, GPIO_NUM_4, GPIO_NUM_5, GPIO_NUM_6,
+  GPIO_NUM_7, GPIO_NUM_8, GPIO_NUM_9, GPIO_NUM_10, GPIO_NUM_11, GPIO_NUM_12, GPIO_NUM_13,
+  GPIO_NUM_14, GPIO_NUM_15, GPIO_NUM_16, GPIO_NUM_17, GPIO_NUM_18, GPIO_NUM_19, GPIO_NUM_20,
+  GPIO_NUM_21, GPIO_NUM_22, GPIO_NUM_23, GPIO_NUM_24, GPIO_NUM_25, GPIO_NUM_26, GPIO_NUM_27,
+  GPIO_NUM_28, GPIO_NUM_29, GPIO_NUM_30, GPIO_NUM_31, GPIO_NUM_32, GPIO_NUM_33, GPIO_NUM_34,
+  GPIO_NUM_35, GPIO_NUM_36, GPIO_NUM_37, GPIO_NUM_38, GPIO_NUM_39
+};
+
+unsigned long millis();
+void delay(unsigned long ms);
+int analogRead(uint8_t pin);
+void analogReadResolution(uint8_t bits);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+
+class String {
+public:
+  String(const char *text = "") : value(text != NULL ? text : "") {}
+  String(const std::string &text) : value(text) {}
+  String(int number) : value(std::to_string(number)) {}
+  String(unsigned int number) : value(std::to_string(number)) {}
+  String(long number) : value(std::to_string(number)) {}
+  String(unsigned long number) : value(std::to_string(number)) {}
+  String(double number, unsigned int decimals = 2) {
+    char text[32];
+    snprintf(text, sizeof(text), "%.*f", (int)decimals, number);
+    value = text;
+  }
+
+  const char *c_str() const { return value.c_str(); }
+  unsigned int length() const { return value.length(); }
+  bool operator==(const String &other) const { return value == other.value; }
+
+  friend String operator+(const String &left, const String &right) {
+    return String(left.value + right.value);
+  }
+
+private:
+  std::string value;
+};
+
+// Serial output is dropped; replay compares BLE values and pin levels instead.
+// Console input is fed by the host drivers.
+class HostSerial {
+public:
+  void begin(unsigned long baud) {}
+  void print(const String &text) {}
+  void println(const String &text = "") {}
+
+  int available() { return input.length(); }
+  int read() {
+    if (input.empty()) return -1;
+    char c = input[0];
+    input.erase(0, 1);
+    return (uint8_t)c;
+  }
+
+  std::string input;
+};
+
+extern HostSerial Serial;
+
+#endif // ARDUINO_H
@@ -0,0 +1 @@
+#include "BLEStubs.h"
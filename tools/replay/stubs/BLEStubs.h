@@ -0,0 +1,91 @@
+#ifndef BLE_STUBS_H
+#define BLE_STUBS_H
+
+// Host stand-in for the ESP32 BLE library used by tools/replay. Writes are
+// injected by the host drivers; setValue() calls are captured as outputs.
+
+#include <Arduino.h>
+#include <string>
+
+class BLEServer;
+class BLECharacteristic;
+
+class BLECharacteristicCallbacks {
+public:
+  virtual ~BLECharacteristicCallbacks() {}
+  virtual void onWrite(BLECharacteristic *pCharacteristic) {}
+};
+
+class BLECharacteristic {
+public:
+  static const uint32_t PROPERTY_READ = 1 << 0;
+  static const uint32_t PROPERTY_WRITE = 1 << 1;
+  static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+
+  BLECharacteristic(const char *uuid) : uuid(uuid), callbacks(NULL) {}
+
+  void setCallbacks(BLECharacteristicCallbacks *pCallbacks) { callbacks = pCallbacks; }
+  BLECharacteristicCallbacks *getCallbacks() { return callbacks; }
+  void setValue(const char *data);
+  void setValue(const std::string &data) { setValue(data.c_str()); }
+  std::string getValue() { return value; }
+  void notify() {}
+
+  // Host only: deliver a client write without recording it as an output
+  void write(const std::string &data) {
+    value = data;
+    if (callbacks != NULL) {
+      callbacks->onWrite(this);
+    }
+  }
+
+  const std::string &getUuid() const { return uuid; }
+
+private:
+  std::string uuid;
+  std::string value;
+  BLECharacteristicCallbacks *callbacks;
+};
+
+class BLEService {
+public:
+  BLECharacteristic *createCharacteristic(const char *uuid, uint32_t properties);
+  void start() {}
+};
+
+class BLEAdvertising {
+public:
+  void addServiceUUID(const char *uuid) {}
+  void start() {}
+};
+
+class BLEServerCallbacks {
+public:
+  virtual ~BLEServerCallbacks() {}
+  virtual void onConnect(BLEServer *pServer) {}
+  virtual void onDisconnect(BLEServer *pServer) {}
+};
+
+class BLEServer {
+public:
+  BLEServer() : callbacks(NULL) {}
+
+  void setCallbacks(BLEServerCallbacks *pCallbacks) { callbacks = pCallbacks; }
+  BLEServerCallbacks *getCallbacks() { return callbacks; }
+  BLEService *createService(const char *uuid) { return new BLEService(); }
+  BLEAdvertising *getAdvertising();
+  uint32_t getConnectedCount();
+
+private:
+  BLEServerCallbacks *callbacks;
+};
+
+class BLEDevice {
+public:
+  static void init(const std::string &deviceName) {}
+  static BLEServer *createServer();
+  static BLEAdvertising *getAdvertising();
+  static void startAdvertising() {}
+};
+
+#endif // BLE_STUBS_H
@@ -0,0 +1,20 @@
+#ifndef PREFERENCES_H
+#define PREFERENCES_H
+
+// Host stand-in for the NVS Preferences library; serves hostPreferences
+// from HostPlatform.h (the calibration points of the trace session when
+// replaying).
+
+#include <stddef.h>
+
+class Preferences {
+public:
+  bool begin(const char *name, bool readOnly = false);
+  void end() {}
+  size_t getBytes(const char *key, void *buffer, size_t maxLength);
+  size_t putBytes(const char *key, const void *value, size_t length);
+  bool remove(const char *key);
+  bool isKey(const char *key);
+};
+
+#endif // PREFERENCES_H
@@ -0,0 +1,22 @@
+#ifndef ESP_ADC_CAL_H
+#define ESP_ADC_CAL_H
+
+// Host stand-in for esp_adc_cal; reproduces the characterization knots set
+// in HostPlatform.h (from the trace session when replaying).
+
+#include <stdint.h>
+
+typedef enum { ADC_UNIT_1 = 1, ADC_UNIT_2 = 2 } adc_unit_t;
+typedef enum { ADC_ATTEN_DB_0, ADC_ATTEN_DB_2_5, ADC_ATTEN_DB_6, ADC_ATTEN_DB_11 } adc_atten_t;
+typedef enum { ADC_WIDTH_BIT_9, ADC_WIDTH_BIT_10, ADC_WIDTH_BIT_11, ADC_WIDTH_BIT_12 } adc_bits_width_t;
+typedef enum { ESP_ADC_CAL_VAL_EFUSE_VREF, ESP_ADC_CAL_VAL_EFUSE_TP, ESP_ADC_CAL_VAL_DEFAULT_VREF } esp_adc_cal_value_t;
+
+typedef struct {
+  adc_unit_t adc_num;
+} esp_adc_cal_characteristics_t;
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t adcNum, adc_atten_t atten, adc_bits_width_t bitWidth,
+                                             uint32_t defaultVref, esp_adc_cal_characteristics_t *chars);
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t adcReading, const esp_adc_cal_characteristics_t *chars);
+
+#endif // ESP_ADC_CAL_H